@@ -0,0 +1,244 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_BENCH_COMMON_H
+#define MPMC_BENCH_COMMON_H
+
+#include <chrono>      // For std::chrono::steady_clock
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstdlib>     // For std::strtol
+#include <cstring>     // For std::strncmp
+#include <memory>      // For std::unique_ptr
+#include <string>      // For std::string
+#include <vector>      // For std::vector
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SQ_BENCH_HAS_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>    // For __rdtsc
+#else
+#include <x86intrin.h> // For __rdtsc
+#endif
+#endif
+
+#include "../shared_queue.h"
+
+// Helpers shared by the benchmarks in this directory
+namespace sq_bench
+{
+  // Payload of exactly Size bytes
+  template <std::size_t Size>
+  struct Payload
+  {
+    unsigned char bytes[Size];
+  };
+
+  // Pin the calling thread to a CPU. Negative cpus leave the thread unpinned.
+  inline bool pin_thread(int cpu)
+  {
+    if (cpu < 0)
+    {
+      return true;
+    }
+
+#if defined(_WIN32)
+    return (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0);
+#else
+    return false;
+#endif
+  }
+
+  // CPUs to pin benchmark threads to, in order: producers first, then consumers.
+  // Threads beyond the end of the list are not pinned.
+  struct Cpu_List
+  {
+    std::vector<int> cpus;
+
+    int at(std::size_t index) const
+    {
+      return (index < this->cpus.size()) ? this->cpus[index] : -1;
+    }
+
+    // Parse "0,2,4-7"
+    bool parse(const char* text)
+    {
+      this->cpus.clear();
+
+      while (*text != '\0')
+      {
+        char* end = nullptr;
+        long first = std::strtol(text, &end, 10);
+
+        if (end == text || first < 0)
+        {
+          return false;
+        }
+
+        long last = first;
+        text = end;
+
+        if (*text == '-')
+        {
+          last = std::strtol(text + 1, &end, 10);
+
+          if (end == text + 1 || last < first)
+          {
+            return false;
+          }
+
+          text = end;
+        }
+
+        for (long cpu = first; cpu <= last; ++cpu)
+        {
+          this->cpus.push_back(static_cast<int>(cpu));
+        }
+
+        if (*text == ',')
+        {
+          ++text;
+        }
+        else if (*text != '\0')
+        {
+          return false;
+        }
+      }
+
+      return true;
+    }
+  };
+
+  // Raw timestamp: the TSC where available (invariant and shared by all
+  // cores and processes on current x86), steady_clock nanoseconds otherwise
+  inline std::uint64_t read_ticks()
+  {
+#if defined(SQ_BENCH_HAS_TSC)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+
+  // Ticks per nanosecond, measured against steady_clock
+  inline double calibrate_ticks_per_ns()
+  {
+#if defined(SQ_BENCH_HAS_TSC)
+    auto begin_time = std::chrono::steady_clock::now();
+    std::uint64_t begin_ticks = read_ticks();
+
+    while (std::chrono::steady_clock::now() - begin_time < std::chrono::milliseconds(100))
+    {
+    }
+
+    std::uint64_t end_ticks = read_ticks();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin_time);
+
+    return static_cast<double>(end_ticks - begin_ticks) / static_cast<double>(elapsed.count());
+#else
+    return 1.0;
+#endif
+  }
+
+  // HDR style histogram: values below 2048 are recorded exactly, larger ones
+  // with 3 significant decimal digits (each power of two is split into 1024
+  // buckets), so percentiles keep their relative precision from nanoseconds
+  // up to hours. The buckets are sq::Basic_Latency_Histogram's; this adds
+  // the exact min and max.
+  class Latency_Histogram
+  {
+  private:
+    typedef sq::Basic_Latency_Histogram<10> Buckets;
+
+    std::unique_ptr<Buckets> buckets{ new Buckets() };
+    std::uint64_t total{ 0 };
+    std::uint64_t min_value{ UINT64_MAX };
+    std::uint64_t max_value{ 0 };
+
+  public:
+    void record(std::uint64_t value)
+    {
+      ++this->buckets->counts[Buckets::bucket_of(value)];
+      ++this->total;
+      this->min_value = (value < this->min_value) ? value : this->min_value;
+      this->max_value = (value > this->max_value) ? value : this->max_value;
+    }
+
+    std::uint64_t count() const
+    {
+      return this->total;
+    }
+
+    std::uint64_t min() const
+    {
+      return (this->total == 0) ? 0 : this->min_value;
+    }
+
+    std::uint64_t max() const
+    {
+      return this->max_value;
+    }
+
+    // Smallest recorded value that percentile percent of the samples do not exceed
+    std::uint64_t percentile(double percent) const
+    {
+      std::uint64_t value = this->buckets->percentile(percent);
+      return (value < this->max_value) ? value : this->max_value;
+    }
+
+    void print(const char* name, const char* unit) const
+    {
+      std::printf("%-24s count=%llu min=%llu p50=%llu p99=%llu p99.9=%llu max=%llu (%s)\n", name,
+        static_cast<unsigned long long>(this->count()),
+        static_cast<unsigned long long>(this->min()),
+        static_cast<unsigned long long>(this->percentile(50.0)),
+        static_cast<unsigned long long>(this->percentile(99.0)),
+        static_cast<unsigned long long>(this->percentile(99.9)),
+        static_cast<unsigned long long>(this->max()),
+        unit);
+    }
+  };
+
+  // Remove "--name=value" from argv and return value, or fallback if absent
+  inline std::string take_flag(int* argc, char** argv, const char* name, const char* fallback)
+  {
+    std::string prefix = std::string("--") + name + "=";
+    std::string value = fallback;
+
+    for (int i = 1; i < *argc; ++i)
+    {
+      if (std::strncmp(argv[i], prefix.c_str(), prefix.size()) == 0)
+      {
+        value = argv[i] + prefix.size();
+
+        for (int j = i; j + 1 < *argc; ++j)
+        {
+          argv[j] = argv[j + 1];
+        }
+
+        --*argc;
+        --i;
+      }
+    }
+
+    return value;
+  }
+} // namespace sq_bench
+
+#endif // MPMC_BENCH_COMMON_H
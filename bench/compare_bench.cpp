@@ -0,0 +1,388 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Runs the same workload against sq::Shared_Queue and other bounded queues
+// and prints one CSV row per run. Each run moves a fixed number of items
+// from the producer threads to the consumer threads through a queue with
+// the same capacity. Producers retry when a queue reports full; Shared_Queue
+// overwrites instead, which shows up in the "dropped" column.
+//
+// Queues whose headers are not found are skipped:
+//   mutex_deque        std::mutex + std::deque baseline (always built)
+//   shared_queue       sq::Shared_Queue (always built)
+//   boost_message_queue boost::interprocess::message_queue (<boost/interprocess/ipc/message_queue.hpp>)
+//   moodycamel         moodycamel::ConcurrentQueue (<concurrentqueue.h> or <moodycamel/concurrentqueue.h>)
+//   folly_mpmc         folly::MPMCQueue (<folly/MPMCQueue.h>, link with -lfolly)
+//
+// Build:
+//   g++ -std=c++17 -O2 -I.. compare_bench.cpp -lpthread -lrt -o compare_bench
+//
+// Flags:
+//   --items=200000   Items moved per run
+//   --max_threads=4  Largest producer and consumer count to run
+//   --repetitions=3  Runs per configuration
+//   --cpus=0-7       Pin producers, then consumers, to these CPUs in order
+
+#include <atomic>      // For std::atomic
+#include <chrono>      // For std::chrono::steady_clock
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstdlib>     // For std::strtoull
+#include <deque>       // For std::deque
+#include <memory>      // For std::unique_ptr
+#include <mutex>       // For std::mutex
+#include <string>      // For std::string
+#include <thread>      // For std::thread
+#include <vector>      // For std::vector
+
+#include "../shared_queue.h"
+#include "bench_common.h"
+
+#if defined(__has_include)
+#if __has_include(<boost/interprocess/ipc/message_queue.hpp>)
+#define SQ_BENCH_HAS_BOOST 1
+#include <boost/interprocess/ipc/message_queue.hpp>
+#endif
+#if __has_include(<concurrentqueue.h>)
+#define SQ_BENCH_HAS_MOODYCAMEL 1
+#include <concurrentqueue.h>
+#elif __has_include(<moodycamel/concurrentqueue.h>)
+#define SQ_BENCH_HAS_MOODYCAMEL 1
+#include <moodycamel/concurrentqueue.h>
+#endif
+#if __has_include(<folly/MPMCQueue.h>)
+#define SQ_BENCH_HAS_FOLLY 1
+#include <folly/MPMCQueue.h>
+#endif
+#endif
+
+namespace
+{
+  constexpr std::size_t queue_capacity = 1024;
+
+  sq_bench::Cpu_List cpu_list;
+
+  // Every adapter exposes try_enqueue/try_dequeue with the same meaning:
+  // false means full or empty right now.
+
+  template <typename T>
+  class Mutex_Deque_Adapter
+  {
+  private:
+    std::mutex mutex;
+    std::deque<T> items;
+
+  public:
+    static const char* name() { return "mutex_deque"; }
+
+    bool try_enqueue(const T& item)
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+
+      if (this->items.size() == queue_capacity)
+      {
+        return false;
+      }
+
+      this->items.push_back(item);
+      return true;
+    }
+
+    bool try_dequeue(T* item)
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+
+      if (this->items.empty())
+      {
+        return false;
+      }
+
+      *item = this->items.front();
+      this->items.pop_front();
+      return true;
+    }
+  };
+
+  template <typename T>
+  class Shared_Queue_Adapter
+  {
+  private:
+    using Queue = sq::Shared_Queue<T, queue_capacity>;
+
+    std::vector<unsigned char> memory;
+    Queue queue;
+
+  public:
+    static const char* name() { return "shared_queue"; }
+
+    bool try_enqueue(const T& item)
+    {
+      return this->queue.enqueue(item);
+    }
+
+    bool try_dequeue(T* item)
+    {
+      return this->queue.dequeue(item);
+    }
+
+    Shared_Queue_Adapter() : memory(Queue::required_size() + 64)
+    {
+      std::size_t misalignment = reinterpret_cast<std::uintptr_t>(this->memory.data()) & 63;
+      this->queue.create(this->memory.data() + ((64 - misalignment) & 63));
+    }
+  };
+
+#if defined(SQ_BENCH_HAS_BOOST)
+  template <typename T>
+  class Boost_Message_Queue_Adapter
+  {
+  private:
+    std::string queue_name;
+    std::unique_ptr<boost::interprocess::message_queue> queue;
+
+  public:
+    static const char* name() { return "boost_message_queue"; }
+
+    bool try_enqueue(const T& item)
+    {
+      return this->queue->try_send(&item, sizeof(T), 0);
+    }
+
+    bool try_dequeue(T* item)
+    {
+      boost::interprocess::message_queue::size_type received = 0;
+      unsigned int priority = 0;
+      return this->queue->try_receive(item, sizeof(T), received, priority);
+    }
+
+    Boost_Message_Queue_Adapter() : queue_name("sq_compare_bench_" + std::to_string(sq_bench::read_ticks()))
+    {
+      boost::interprocess::message_queue::remove(this->queue_name.c_str());
+      this->queue.reset(new boost::interprocess::message_queue(
+        boost::interprocess::create_only, this->queue_name.c_str(), queue_capacity, sizeof(T)));
+    }
+
+    ~Boost_Message_Queue_Adapter()
+    {
+      this->queue.reset();
+      boost::interprocess::message_queue::remove(this->queue_name.c_str());
+    }
+  };
+#endif
+
+#if defined(SQ_BENCH_HAS_MOODYCAMEL)
+  template <typename T>
+  class Moodycamel_Adapter
+  {
+  private:
+    moodycamel::ConcurrentQueue<T> queue{ queue_capacity };
+
+  public:
+    static const char* name() { return "moodycamel"; }
+
+    // try_enqueue never allocates, which keeps the queue bounded like the others
+    bool try_enqueue(const T& item)
+    {
+      return this->queue.try_enqueue(item);
+    }
+
+    bool try_dequeue(T* item)
+    {
+      return this->queue.try_dequeue(*item);
+    }
+  };
+#endif
+
+#if defined(SQ_BENCH_HAS_FOLLY)
+  template <typename T>
+  class Folly_Mpmc_Adapter
+  {
+  private:
+    folly::MPMCQueue<T> queue{ queue_capacity };
+
+  public:
+    static const char* name() { return "folly_mpmc"; }
+
+    bool try_enqueue(const T& item)
+    {
+      return this->queue.write(item);
+    }
+
+    bool try_dequeue(T* item)
+    {
+      return this->queue.read(*item);
+    }
+  };
+#endif
+
+  struct Run_Result
+  {
+    double seconds{ 0 };
+    std::uint64_t consumed{ 0 };
+    std::uint64_t produced{ 0 };
+  };
+
+  template <typename Adapter, typename T>
+  Run_Result run_once(std::size_t producers, std::size_t consumers, std::uint64_t items)
+  {
+    Adapter adapter;
+    std::atomic<std::size_t> ready{ 0 };
+    std::atomic<bool> start{ false };
+    std::atomic<std::size_t> producers_done{ 0 };
+    std::atomic<std::uint64_t> consumed{ 0 };
+    std::uint64_t per_producer = items / producers;
+    std::uint64_t produced = per_producer * producers;
+    std::vector<std::thread> threads;
+
+    for (std::size_t i = 0; i < producers + consumers; ++i)
+    {
+      threads.emplace_back([&, i]()
+      {
+        sq_bench::pin_thread(cpu_list.at(i));
+        ready.fetch_add(1);
+
+        while (!start.load(std::memory_order_acquire))
+        {
+        }
+
+        if (i < producers)
+        {
+          T item{};
+
+          for (std::uint64_t n = 0; n < per_producer; ++n)
+          {
+            item.bytes[0] = static_cast<unsigned char>(n);
+
+            while (!adapter.try_enqueue(item))
+            {
+              std::this_thread::yield();
+            }
+          }
+
+          producers_done.fetch_add(1, std::memory_order_release);
+          return;
+        }
+
+        T item;
+
+        while (consumed.load(std::memory_order_relaxed) < produced)
+        {
+          if (adapter.try_dequeue(&item))
+          {
+            consumed.fetch_add(1, std::memory_order_relaxed);
+          }
+          else if (producers_done.load(std::memory_order_acquire) == producers)
+          {
+            // Drained; only a lossy queue gets here before everything arrived
+            if (!adapter.try_dequeue(&item))
+            {
+              break;
+            }
+
+            consumed.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+
+    while (ready.load() != producers + consumers)
+    {
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+
+    for (std::thread& thread : threads)
+    {
+      thread.join();
+    }
+
+    Run_Result result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    result.consumed = consumed.load();
+    result.produced = produced;
+
+    return result;
+  }
+
+  struct Options
+  {
+    std::uint64_t items{ 200000 };
+    std::size_t max_threads{ 4 };
+    std::size_t repetitions{ 3 };
+  };
+
+  template <template <typename> class Adapter, std::size_t Size>
+  void run_size(const Options& options)
+  {
+    using Item = sq_bench::Payload<Size>;
+
+    for (std::size_t producers = 1; producers <= options.max_threads; producers *= 2)
+    {
+      for (std::size_t consumers = 1; consumers <= options.max_threads; consumers *= 2)
+      {
+        for (std::size_t repetition = 0; repetition < options.repetitions; ++repetition)
+        {
+          Run_Result result = run_once<Adapter<Item>, Item>(producers, consumers, options.items);
+          std::uint64_t dropped = (result.consumed < result.produced) ? result.produced - result.consumed : 0;
+
+          std::printf("%s,%zu,%zu,%zu,%zu,%llu,%.6f,%.0f,%llu\n", Adapter<Item>::name(), Size, queue_capacity,
+            producers, consumers, static_cast<unsigned long long>(result.produced), result.seconds,
+            static_cast<double>(result.consumed) / result.seconds, static_cast<unsigned long long>(dropped));
+          std::fflush(stdout);
+        }
+      }
+    }
+  }
+
+  template <template <typename> class Adapter>
+  void run_queue(const Options& options)
+  {
+    run_size<Adapter, 16>(options);
+    run_size<Adapter, 256>(options);
+    run_size<Adapter, 4096>(options);
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  std::string cpus = sq_bench::take_flag(&argc, argv, "cpus", "");
+
+  options.items = std::strtoull(sq_bench::take_flag(&argc, argv, "items", "200000").c_str(), nullptr, 10);
+  options.max_threads = std::strtoull(sq_bench::take_flag(&argc, argv, "max_threads", "4").c_str(), nullptr, 10);
+  options.repetitions = std::strtoull(sq_bench::take_flag(&argc, argv, "repetitions", "3").c_str(), nullptr, 10);
+
+  if (argc > 1)
+  {
+    std::fprintf(stderr, "Unknown argument: %s\n", argv[1]);
+    return 1;
+  }
+
+  if (!cpus.empty() && !cpu_list.parse(cpus.c_str()))
+  {
+    std::fprintf(stderr, "Invalid --cpus list: %s\n", cpus.c_str());
+    return 1;
+  }
+
+  options.max_threads = (options.max_threads == 0) ? 1 : options.max_threads;
+
+  std::printf("queue,item_size,capacity,producers,consumers,items,seconds,items_per_second,dropped\n");
+
+  run_queue<Mutex_Deque_Adapter>(options);
+  run_queue<Shared_Queue_Adapter>(options);
+#if defined(SQ_BENCH_HAS_BOOST)
+  run_queue<Boost_Message_Queue_Adapter>(options);
+#endif
+#if defined(SQ_BENCH_HAS_MOODYCAMEL)
+  run_queue<Moodycamel_Adapter>(options);
+#endif
+#if defined(SQ_BENCH_HAS_FOLLY)
+  run_queue<Folly_Mpmc_Adapter>(options);
+#endif
+
+  return 0;
+}
@@ -0,0 +1,355 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Cross-process latency of sq::Shared_Queue. The parent creates a shm_open
+// segment and forks two processes, each of which maps the segment on its
+// own (separate mappings, as in a real deployment) and attaches to the
+// queues in it.
+//
+//   one_way    The producer stamps every message with the TSC and the
+//              consumer records now - stamp. Sends are paced so the queue
+//              never fills up and overwrites.
+//   ping_pong  The pinger sends a stamped message, the ponger echoes it back
+//              on a second queue, and the pinger records the round trip.
+//
+// Results are reported as p50/p99/p99.9/max in nanoseconds. One-way numbers
+// rely on an invariant TSC that is synchronized across cores.
+//
+// Build (POSIX only):
+//   g++ -std=c++17 -O2 -I.. latency_bench.cpp -lpthread -lrt -o latency_bench
+//
+// Flags:
+//   --mode=one_way|ping_pong|both   Default both
+//   --iterations=100000             Measured messages per mode
+//   --warmup=10000                  Messages sent before measuring
+//   --interval_ns=1000              Gap between one-way sends
+//   --cpus=2,4                      Pin the producer/pinger, then the consumer/ponger
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf, std::fprintf
+#include <cstdlib>     // For std::strtoull, std::exit
+#include <string>      // For std::string, std::to_string
+#include <new>         // For placement new
+
+#include <fcntl.h>     // For O_CREAT, O_RDWR
+#include <sys/mman.h>  // For shm_open, mmap
+#include <sys/wait.h>  // For waitpid
+#include <unistd.h>    // For fork, ftruncate
+
+#include "../shared_queue.h"
+#include "bench_common.h"
+
+namespace
+{
+  constexpr std::size_t queue_capacity = 1024;
+
+  struct Latency_Message
+  {
+    std::uint64_t sequence;
+    std::uint64_t ticks;    // read_ticks() when the message was sent
+  };
+
+  using Queue = sq::Shared_Queue<Latency_Message, queue_capacity>;
+
+  // Start of the segment; the queues follow on their own cache lines
+  struct Segment_Header
+  {
+    std::atomic<std::uint32_t> ready;  // Processes attached so far
+    std::atomic<bool> start;           // Set by the parent once both are ready
+    std::atomic<bool> done;            // Set by the sender after its last message
+  };
+
+  constexpr std::size_t round_up(std::size_t size)
+  {
+    return (size + 63) & ~std::size_t(63);
+  }
+
+  constexpr std::size_t forward_offset = round_up(sizeof(Segment_Header));
+  constexpr std::size_t backward_offset = forward_offset + round_up(Queue::required_size());
+  constexpr std::size_t segment_size = backward_offset + round_up(Queue::required_size());
+
+  struct Options
+  {
+    std::string mode{ "both" };
+    std::uint64_t iterations{ 100000 };
+    std::uint64_t warmup{ 10000 };
+    std::uint64_t interval_ns{ 1000 };
+    sq_bench::Cpu_List cpus;
+    double ticks_per_ns{ 1.0 };
+  };
+
+  // What one process sees of the segment, through its own mapping
+  struct Attachment
+  {
+    Segment_Header* header{ nullptr };
+    Queue forward;   // Producer/pinger to consumer/ponger
+    Queue backward;  // Ponger to pinger
+
+    bool attach(const char* name)
+    {
+      int fd = shm_open(name, O_RDWR, 0600);
+
+      if (fd == -1)
+      {
+        return false;
+      }
+
+      void* memory = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+
+      if (memory == MAP_FAILED)
+      {
+        return false;
+      }
+
+      char* base = static_cast<char*>(memory);
+      this->header = reinterpret_cast<Segment_Header*>(base);
+      this->forward.create(base + forward_offset);
+      this->backward.create(base + backward_offset);
+
+      return true;
+    }
+
+    void wait_for_start()
+    {
+      this->header->ready.fetch_add(1);
+
+      while (!this->header->start.load(std::memory_order_acquire))
+      {
+      }
+    }
+  };
+
+  std::uint64_t to_ns(std::uint64_t ticks, const Options& options)
+  {
+    return static_cast<std::uint64_t>(static_cast<double>(ticks) / options.ticks_per_ns);
+  }
+
+  void run_one_way_producer(Attachment& attachment, const Options& options)
+  {
+    std::uint64_t interval = static_cast<std::uint64_t>(static_cast<double>(options.interval_ns) * options.ticks_per_ns);
+    std::uint64_t next_send = sq_bench::read_ticks();
+
+    for (std::uint64_t i = 0; i < options.warmup + options.iterations; ++i)
+    {
+      while (sq_bench::read_ticks() < next_send)
+      {
+      }
+
+      Latency_Message message{ i, sq_bench::read_ticks() };
+      attachment.forward.enqueue(message);
+      next_send = message.ticks + interval;
+    }
+
+    attachment.header->done.store(true, std::memory_order_release);
+  }
+
+  void run_one_way_consumer(Attachment& attachment, const Options& options)
+  {
+    sq_bench::Latency_Histogram histogram;
+    Latency_Message message;
+    std::uint64_t received = 0;
+
+    while (true)
+    {
+      if (attachment.forward.dequeue(&message))
+      {
+        std::uint64_t now = sq_bench::read_ticks();
+        ++received;
+
+        if (message.sequence >= options.warmup)
+        {
+          histogram.record(to_ns(now - message.ticks, options));
+        }
+      }
+      else if (attachment.header->done.load(std::memory_order_acquire) && attachment.forward.is_empty())
+      {
+        break;
+      }
+    }
+
+    histogram.print("one_way", "ns");
+
+    if (received != options.warmup + options.iterations)
+    {
+      std::printf("one_way: %llu of %llu messages lost to overwrites; raise --interval_ns\n",
+        static_cast<unsigned long long>(options.warmup + options.iterations - received),
+        static_cast<unsigned long long>(options.warmup + options.iterations));
+    }
+  }
+
+  void run_pinger(Attachment& attachment, const Options& options)
+  {
+    sq_bench::Latency_Histogram histogram;
+    Latency_Message message;
+
+    for (std::uint64_t i = 0; i < options.warmup + options.iterations; ++i)
+    {
+      attachment.forward.enqueue(Latency_Message{ i, sq_bench::read_ticks() });
+
+      while (!attachment.backward.dequeue(&message))
+      {
+      }
+
+      std::uint64_t now = sq_bench::read_ticks();
+
+      if (i >= options.warmup)
+      {
+        histogram.record(to_ns(now - message.ticks, options));
+      }
+    }
+
+    attachment.header->done.store(true, std::memory_order_release);
+    histogram.print("ping_pong (round trip)", "ns");
+  }
+
+  void run_ponger(Attachment& attachment, const Options& options)
+  {
+    Latency_Message message;
+
+    for (std::uint64_t i = 0; i < options.warmup + options.iterations; ++i)
+    {
+      while (!attachment.forward.dequeue(&message))
+      {
+      }
+
+      attachment.backward.enqueue(message);
+    }
+  }
+
+  // Create a fresh segment, fork the two sides and wait for both
+  bool run_mode(const char* mode, const Options& options)
+  {
+    std::string name = "/sq_latency_bench_" + std::to_string(getpid());
+    shm_unlink(name.c_str());
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    if (fd == -1 || ftruncate(fd, static_cast<off_t>(segment_size)) != 0)
+    {
+      std::perror("shm_open");
+      return false;
+    }
+
+    void* memory = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (memory == MAP_FAILED)
+    {
+      std::perror("mmap");
+      shm_unlink(name.c_str());
+      return false;
+    }
+
+    // The segment starts zeroed, so create() initializes both queues
+    Segment_Header* header = new (memory) Segment_Header();
+    Queue(static_cast<char*>(memory) + forward_offset);
+    Queue(static_cast<char*>(memory) + backward_offset);
+
+    pid_t children[2];
+    bool one_way = (std::string(mode) == "one_way");
+
+    for (int side = 0; side < 2; ++side)
+    {
+      children[side] = fork();
+
+      if (children[side] == 0)
+      {
+        Attachment attachment;
+
+        if (!attachment.attach(name.c_str()))
+        {
+          std::perror("attach");
+          std::exit(1);
+        }
+
+        sq_bench::pin_thread(options.cpus.at(static_cast<std::size_t>(side)));
+        attachment.wait_for_start();
+
+        if (side == 0)
+        {
+          one_way ? run_one_way_producer(attachment, options) : run_pinger(attachment, options);
+        }
+        else
+        {
+          one_way ? run_one_way_consumer(attachment, options) : run_ponger(attachment, options);
+        }
+
+        std::fflush(stdout);
+        std::exit(0);
+      }
+    }
+
+    while (header->ready.load() != 2)
+    {
+    }
+
+    header->start.store(true, std::memory_order_release);
+
+    bool succeeded = true;
+
+    for (pid_t child : children)
+    {
+      int status = 0;
+      waitpid(child, &status, 0);
+      succeeded = succeeded && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    munmap(memory, segment_size);
+    shm_unlink(name.c_str());
+
+    return succeeded;
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  Options options;
+  std::string cpus = sq_bench::take_flag(&argc, argv, "cpus", "");
+
+  options.mode = sq_bench::take_flag(&argc, argv, "mode", "both");
+  options.iterations = std::strtoull(sq_bench::take_flag(&argc, argv, "iterations", "100000").c_str(), nullptr, 10);
+  options.warmup = std::strtoull(sq_bench::take_flag(&argc, argv, "warmup", "10000").c_str(), nullptr, 10);
+  options.interval_ns = std::strtoull(sq_bench::take_flag(&argc, argv, "interval_ns", "1000").c_str(), nullptr, 10);
+
+  if (argc > 1)
+  {
+    std::fprintf(stderr, "Unknown argument: %s\n", argv[1]);
+    return 1;
+  }
+
+  if (!cpus.empty() && !options.cpus.parse(cpus.c_str()))
+  {
+    std::fprintf(stderr, "Invalid --cpus list: %s\n", cpus.c_str());
+    return 1;
+  }
+
+  if (options.mode != "one_way" && options.mode != "ping_pong" && options.mode != "both")
+  {
+    std::fprintf(stderr, "Invalid --mode: %s\n", options.mode.c_str());
+    return 1;
+  }
+
+  options.ticks_per_ns = sq_bench::calibrate_ticks_per_ns();
+  std::printf("ticks/ns=%.3f iterations=%llu warmup=%llu\n", options.ticks_per_ns,
+    static_cast<unsigned long long>(options.iterations), static_cast<unsigned long long>(options.warmup));
+  std::fflush(stdout);
+
+  bool succeeded = true;
+
+  if (options.mode != "ping_pong")
+  {
+    succeeded = run_mode("one_way", options) && succeeded;
+  }
+
+  if (options.mode != "one_way")
+  {
+    succeeded = run_mode("ping_pong", options) && succeeded;
+  }
+
+  return succeeded ? 0 : 1;
+}
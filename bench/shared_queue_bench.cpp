@@ -0,0 +1,213 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Throughput of sq::Shared_Queue for 1..N producers x 1..N consumers, several
+// item sizes and capacities. Each benchmark iteration moves a fixed number of
+// items from the producer threads to the consumer threads and reports
+// items/s; items overwritten by a full queue are reported as "dropped".
+//
+// Build (Google Benchmark):
+//   g++ -std=c++17 -O2 -I.. shared_queue_bench.cpp -lbenchmark -lpthread -o shared_queue_bench
+//
+// Extra flags (all other flags go to Google Benchmark):
+//   --cpus=0,2,4-7   Pin producers, then consumers, to these CPUs in order
+//   --max_threads=4  Largest producer and consumer count to run
+
+#include <atomic>      // For std::atomic
+#include <chrono>      // For std::chrono::steady_clock
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uintptr_t, std::int64_t
+#include <cstdio>      // For std::fprintf
+#include <cstdlib>     // For std::atoi
+#include <cstring>     // For std::memset
+#include <memory>      // For std::shared_ptr
+#include <string>      // For std::string, std::to_string
+#include <thread>      // For std::thread
+#include <vector>      // For std::vector
+
+#include <benchmark/benchmark.h>
+
+#include "../shared_queue.h"
+#include "bench_common.h"
+
+namespace
+{
+  constexpr std::size_t items_per_iteration = 1 << 16;
+
+  sq_bench::Cpu_List cpu_list;
+
+  template <std::size_t Size, std::size_t Capacity>
+  struct Queue_Context
+  {
+    using Queue = sq::Shared_Queue<sq_bench::Payload<Size>, Capacity>;
+
+    std::vector<unsigned char> memory;
+    unsigned char* segment{ nullptr };
+    Queue queue;
+
+    // Start from a zeroed segment, as a fresh mapping would be, so no
+    // iteration sees the head, tail or slot sequences of the previous one
+    void recreate()
+    {
+      std::memset(this->segment, 0, Queue::required_size());
+      this->queue.create(this->segment);
+    }
+
+    Queue_Context() : memory(Queue::required_size() + 64)
+    {
+      // Align the queue like a freshly mapped page would be
+      std::size_t misalignment = reinterpret_cast<std::uintptr_t>(this->memory.data()) & 63;
+      this->segment = this->memory.data() + ((64 - misalignment) & 63);
+      this->recreate();
+    }
+  };
+
+  template <std::size_t Size, std::size_t Capacity>
+  void run_throughput(benchmark::State& state, Queue_Context<Size, Capacity>* context,
+    std::size_t producers, std::size_t consumers)
+  {
+    using Item = sq_bench::Payload<Size>;
+
+    std::size_t dropped = 0;
+    std::size_t moved = 0;
+
+    for (auto _ : state)
+    {
+      std::atomic<std::size_t> ready{ 0 };
+      std::atomic<bool> start{ false };
+      std::atomic<std::size_t> producers_done{ 0 };
+      std::atomic<std::size_t> consumed{ 0 };
+      std::size_t per_producer = items_per_iteration / producers;
+      std::size_t produced = per_producer * producers;
+      std::vector<std::thread> threads;
+
+      context->recreate();
+
+      for (std::size_t i = 0; i < producers + consumers; ++i)
+      {
+        threads.emplace_back([&, i]()
+        {
+          sq_bench::pin_thread(cpu_list.at(i));
+          ready.fetch_add(1);
+
+          while (!start.load(std::memory_order_acquire))
+          {
+          }
+
+          if (i < producers)
+          {
+            Item item{};
+
+            for (std::size_t n = 0; n < per_producer; ++n)
+            {
+              item.bytes[0] = static_cast<unsigned char>(n);
+              context->queue.enqueue(item);
+            }
+
+            producers_done.fetch_add(1, std::memory_order_release);
+            return;
+          }
+
+          Item item;
+
+          // Stop once everything arrived, or the producers are done and the
+          // queue is drained (overwritten items never arrive).
+          while (consumed.load(std::memory_order_relaxed) < produced)
+          {
+            if (context->queue.dequeue(&item))
+            {
+              benchmark::DoNotOptimize(item);
+              consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+            else if (producers_done.load(std::memory_order_acquire) == producers)
+            {
+              break;
+            }
+          }
+        });
+      }
+
+      while (ready.load() != producers + consumers)
+      {
+      }
+
+      auto begin = std::chrono::steady_clock::now();
+      start.store(true, std::memory_order_release);
+
+      for (std::thread& thread : threads)
+      {
+        thread.join();
+      }
+
+      auto end = std::chrono::steady_clock::now();
+      state.SetIterationTime(std::chrono::duration<double>(end - begin).count());
+
+      moved += consumed.load();
+      dropped += produced - ((consumed.load() < produced) ? consumed.load() : produced);
+    }
+
+    state.SetItemsProcessed(static_cast<std::int64_t>(moved));
+    state.SetBytesProcessed(static_cast<std::int64_t>(moved * Size));
+    state.counters["dropped"] = benchmark::Counter(static_cast<double>(dropped), benchmark::Counter::kAvgIterations);
+  }
+
+  template <std::size_t Size, std::size_t Capacity>
+  void register_throughput(std::size_t max_threads)
+  {
+    auto context = std::make_shared<Queue_Context<Size, Capacity>>();
+
+    for (std::size_t producers = 1; producers <= max_threads; producers *= 2)
+    {
+      for (std::size_t consumers = 1; consumers <= max_threads; consumers *= 2)
+      {
+        std::string name = "Shared_Queue/item:" + std::to_string(Size) + "B/capacity:" + std::to_string(Capacity) +
+          "/producers:" + std::to_string(producers) + "/consumers:" + std::to_string(consumers);
+
+        benchmark::RegisterBenchmark(name.c_str(), [context, producers, consumers](benchmark::State& state)
+        {
+          run_throughput<Size, Capacity>(state, context.get(), producers, consumers);
+        })->UseManualTime()->Unit(benchmark::kMillisecond);
+      }
+    }
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  std::string cpus = sq_bench::take_flag(&argc, argv, "cpus", "");
+  std::size_t max_threads = static_cast<std::size_t>(std::atoi(sq_bench::take_flag(&argc, argv, "max_threads", "4").c_str()));
+
+  if (!cpus.empty() && !cpu_list.parse(cpus.c_str()))
+  {
+    std::fprintf(stderr, "Invalid --cpus list: %s\n", cpus.c_str());
+    return 1;
+  }
+
+  if (max_threads == 0)
+  {
+    max_threads = 1;
+  }
+
+  register_throughput<4, 64>(max_threads);
+  register_throughput<4, 4096>(max_threads);
+  register_throughput<64, 64>(max_threads);
+  register_throughput<64, 4096>(max_threads);
+  register_throughput<512, 64>(max_threads);
+  register_throughput<512, 4096>(max_threads);
+  register_throughput<4096, 64>(max_threads);
+  register_throughput<4096, 4096>(max_threads);
+
+  benchmark::Initialize(&argc, argv);
+
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+  {
+    return 1;
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+
+  return 0;
+}
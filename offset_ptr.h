@@ -0,0 +1,297 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_OFFSET_PTR_H
+#define MPMC_OFFSET_PTR_H
+
+#include <cstddef>     // For std::size_t, std::ptrdiff_t, std::nullptr_t
+#include <cstdint>     // For std::uintptr_t
+#include <iterator>    // For std::forward_iterator_tag
+#include <type_traits> // For std::is_convertible, std::add_lvalue_reference
+
+namespace sq
+{
+  // Pointer that stores the distance from itself to its target instead of an
+  // address, so structures linked with it stay valid when the shared memory
+  // is mapped at different addresses in different processes. Both the
+  // offset_ptr and its target must live in the same shared memory.
+  //
+  // Copying an offset_ptr recomputes the distance for the new location, so
+  // types holding one must be copied with their copy constructor or
+  // assignment operator, never with memcpy.
+  template <typename T>
+  class offset_ptr
+  {
+  private:
+    // A distance of 1 can never point at a T from an aligned offset_ptr,
+    // so it is used to represent nullptr
+    static constexpr std::ptrdiff_t null_offset = 1;
+
+    std::ptrdiff_t offset{ null_offset };
+
+    std::uintptr_t self() const
+    {
+      return reinterpret_cast<std::uintptr_t>(this);
+    }
+
+    void set(T* pointer)
+    {
+      if (pointer == nullptr)
+      {
+        this->offset = null_offset;
+        return;
+      }
+
+      this->offset = static_cast<std::ptrdiff_t>(reinterpret_cast<std::uintptr_t>(pointer) - this->self());
+    }
+
+  public:
+    using element_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    T* get() const
+    {
+      if (this->offset == null_offset)
+      {
+        return nullptr;
+      }
+
+      return reinterpret_cast<T*>(this->self() + static_cast<std::uintptr_t>(this->offset));
+    }
+
+    typename std::add_lvalue_reference<T>::type operator*() const
+    {
+      return *this->get();
+    }
+
+    T* operator->() const
+    {
+      return this->get();
+    }
+
+    typename std::add_lvalue_reference<T>::type operator[](std::ptrdiff_t index) const
+    {
+      return this->get()[index];
+    }
+
+    explicit operator bool() const
+    {
+      return (this->offset != null_offset);
+    }
+
+    offset_ptr& operator=(const offset_ptr& other)
+    {
+      this->set(other.get());
+      return *this;
+    }
+
+    offset_ptr& operator=(T* pointer)
+    {
+      this->set(pointer);
+      return *this;
+    }
+
+    offset_ptr& operator+=(std::ptrdiff_t count)
+    {
+      this->set(this->get() + count);
+      return *this;
+    }
+
+    offset_ptr& operator-=(std::ptrdiff_t count)
+    {
+      this->set(this->get() - count);
+      return *this;
+    }
+
+    offset_ptr& operator++()
+    {
+      return (*this += 1);
+    }
+
+    offset_ptr& operator--()
+    {
+      return (*this -= 1);
+    }
+
+    friend bool operator==(const offset_ptr& left, const offset_ptr& right)
+    {
+      return (left.get() == right.get());
+    }
+
+    friend bool operator!=(const offset_ptr& left, const offset_ptr& right)
+    {
+      return (left.get() != right.get());
+    }
+
+    friend bool operator<(const offset_ptr& left, const offset_ptr& right)
+    {
+      return (left.get() < right.get());
+    }
+
+    offset_ptr(const offset_ptr& other)
+    {
+      this->set(other.get());
+    }
+
+    template <typename U, typename = typename std::enable_if<std::is_convertible<U*, T*>::value>::type>
+    offset_ptr(const offset_ptr<U>& other)
+    {
+      this->set(other.get());
+    }
+
+    offset_ptr(T* pointer)
+    {
+      this->set(pointer);
+    }
+
+    offset_ptr(std::nullptr_t) {}
+
+    // Default constructor
+    offset_ptr() = default;
+  };
+
+  // View of size contiguous elements in shared memory
+  template <typename T>
+  struct offset_span
+  {
+    offset_ptr<T> data;
+    std::size_t size{ 0 };
+
+    T* begin() const
+    {
+      return this->data.get();
+    }
+
+    T* end() const
+    {
+      return this->data.get() + this->size;
+    }
+
+    T& operator[](std::size_t index) const
+    {
+      return this->data[static_cast<std::ptrdiff_t>(index)];
+    }
+
+    bool empty() const
+    {
+      return (this->size == 0);
+    }
+  };
+
+  // Node of an offset_list. Nodes are allocated by the caller inside the
+  // shared memory, e.g. from a Shared_Block_Pool.
+  template <typename T>
+  struct offset_list_node
+  {
+    T value;
+    offset_ptr<offset_list_node> next;
+  };
+
+  // Intrusive singly linked list whose links are offset_ptrs
+  template <typename T>
+  class offset_list
+  {
+  private:
+    offset_ptr<offset_list_node<T>> head;
+    std::size_t count{ 0 };
+
+  public:
+    using node_type = offset_list_node<T>;
+
+    class iterator
+    {
+    private:
+      node_type* node{ nullptr };
+
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = T*;
+      using reference = T&;
+
+      T& operator*() const
+      {
+        return this->node->value;
+      }
+
+      T* operator->() const
+      {
+        return &this->node->value;
+      }
+
+      iterator& operator++()
+      {
+        this->node = this->node->next.get();
+        return *this;
+      }
+
+      friend bool operator==(const iterator& left, const iterator& right)
+      {
+        return (left.node == right.node);
+      }
+
+      friend bool operator!=(const iterator& left, const iterator& right)
+      {
+        return (left.node != right.node);
+      }
+
+      explicit iterator(node_type* node) : node(node) {}
+
+      // Default constructor
+      iterator() = default;
+    };
+
+    iterator begin() const
+    {
+      return iterator(this->head.get());
+    }
+
+    iterator end() const
+    {
+      return iterator();
+    }
+
+    bool empty() const
+    {
+      return !this->head;
+    }
+
+    std::size_t size() const
+    {
+      return this->count;
+    }
+
+    node_type* front() const
+    {
+      return this->head.get();
+    }
+
+    // Link node in front of the list. The list does not take ownership.
+    void push_front(node_type* node)
+    {
+      node->next = this->head;
+      this->head = node;
+      ++this->count;
+    }
+
+    // Unlink the front node and return it, or nullptr if the list is empty
+    node_type* pop_front()
+    {
+      node_type* node = this->head.get();
+
+      if (node != nullptr)
+      {
+        this->head = node->next;
+        node->next = nullptr;
+        --this->count;
+      }
+
+      return node;
+    }
+  };
+} // namespace sq
+
+#endif // MPMC_OFFSET_PTR_H
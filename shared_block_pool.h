@@ -0,0 +1,180 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_BLOCK_POOL_H
+#define MPMC_SHARED_BLOCK_POOL_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint32_t, std::uint64_t
+#include <new>         // For placement new
+
+namespace sq
+{
+  // Lock-free pool of Block_Count fixed-size blocks in shared memory.
+  // Free blocks form a stack of indices whose head carries an ABA tag.
+  // The links live outside the blocks, so block contents are never touched
+  // by the pool. Blocks are identified by index, which is valid in every
+  // process regardless of where the segment is mapped.
+  template <std::size_t Block_Size, std::size_t Block_Count>
+  class Shared_Block_Pool
+  {
+  private:
+    static_assert(Block_Size > 0 && Block_Size % 64 == 0, "Block_Size must be a multiple of 64");
+    static_assert(Block_Count > 0 && Block_Count < UINT32_MAX, "Block_Count must fit in 32 bits");
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    struct Shared_Control_Block
+    {
+      std::atomic<std::uint64_t> free_head; // Tag in the high half, block index in the low half
+      std::atomic<std::size_t> available;   // Number of free blocks
+      char head_padding[cache_line_size - sizeof(std::atomic<std::uint64_t>) - sizeof(std::atomic<std::size_t>)];
+      std::size_t block_size{ 0 };          // Size of each block
+      std::size_t block_count{ 0 };         // Number of blocks
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    std::atomic<std::uint32_t>* next{ nullptr };    // Free list links, one per block
+    char* blocks{ nullptr };                        // Block storage
+
+    constexpr static std::size_t align_up(std::size_t size, std::size_t alignment)
+    {
+      return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    constexpr static std::size_t links_offset()
+    {
+      return align_up(sizeof(Shared_Control_Block), alignof(std::max_align_t));
+    }
+
+    constexpr static std::size_t blocks_offset()
+    {
+      return align_up(links_offset() + (sizeof(std::atomic<std::uint32_t>) * Block_Count), cache_line_size);
+    }
+
+    constexpr static std::uint64_t pack(std::uint64_t tag, std::uint32_t index)
+    {
+      return (tag << 32) | index;
+    }
+
+  public:
+    static constexpr std::uint32_t invalid_block = UINT32_MAX;
+
+    constexpr static std::size_t required_size()
+    {
+      return blocks_offset() + (Block_Size * Block_Count);
+    }
+
+    // Number of free blocks
+    std::size_t available() const
+    {
+      return this->control_block->available.load(std::memory_order_acquire);
+    }
+
+    // Take a block off the free list. Returns invalid_block if the pool is exhausted.
+    std::uint32_t allocate()
+    {
+      std::uint64_t head = this->control_block->free_head.load(std::memory_order_acquire);
+
+      while (true)
+      {
+        std::uint32_t index = static_cast<std::uint32_t>(head);
+
+        if (index == invalid_block)
+        {
+          return invalid_block;
+        }
+
+        // May be stale if another thread popped index meanwhile; the tag makes the CAS fail then
+        std::uint32_t successor = this->next[index].load(std::memory_order_relaxed);
+
+        if (this->control_block->free_head.compare_exchange_weak(head, pack((head >> 32) + 1, successor),
+          std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+          this->control_block->available.fetch_sub(1, std::memory_order_relaxed);
+          return index;
+        }
+      }
+    }
+
+    // Return a block to the free list
+    void deallocate(std::uint32_t index)
+    {
+      std::uint64_t head = this->control_block->free_head.load(std::memory_order_relaxed);
+
+      while (true)
+      {
+        this->next[index].store(static_cast<std::uint32_t>(head), std::memory_order_relaxed);
+
+        if (this->control_block->free_head.compare_exchange_weak(head, pack((head >> 32) + 1, index),
+          std::memory_order_release, std::memory_order_relaxed))
+        {
+          this->control_block->available.fetch_add(1, std::memory_order_relaxed);
+          return;
+        }
+      }
+    }
+
+    // Address of a block in this process
+    void* block(std::uint32_t index) const
+    {
+      return this->blocks + (static_cast<std::size_t>(index) * Block_Size);
+    }
+
+    // Offset of a block from the start of the pool's shared memory
+    constexpr static std::size_t offset_of(std::uint32_t index)
+    {
+      return blocks_offset() + (static_cast<std::size_t>(index) * Block_Size);
+    }
+
+    // Block index for an offset returned by offset_of()
+    constexpr static std::uint32_t index_of(std::size_t offset)
+    {
+      return static_cast<std::uint32_t>((offset - blocks_offset()) / Block_Size);
+    }
+
+    // Create pool. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Block_Pool<Block_Size, Block_Count>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->next = reinterpret_cast<std::atomic<std::uint32_t>*>(
+        static_cast<char*>(shared_memory) + links_offset()
+        );
+      this->blocks = static_cast<char*>(shared_memory) + blocks_offset();
+
+      if (this->control_block->block_size != Block_Size ||
+          this->control_block->block_count != Block_Count)
+      {
+        // Initialize control block and chain every block into the free list
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->block_size = Block_Size;
+        this->control_block->block_count = Block_Count;
+
+        for (std::size_t i = 0; i < Block_Count; ++i)
+        {
+          std::uint32_t successor = (i + 1 < Block_Count) ? static_cast<std::uint32_t>(i + 1) : invalid_block;
+          new (&this->next[i]) std::atomic<std::uint32_t>(successor);
+        }
+
+        this->control_block->free_head.store(pack(0, 0), std::memory_order_relaxed);
+        this->control_block->available.store(Block_Count, std::memory_order_release);
+      }
+
+      return true;
+    }
+
+    explicit Shared_Block_Pool(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Block_Pool() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_BLOCK_POOL_H
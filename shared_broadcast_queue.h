@@ -0,0 +1,288 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_BROADCAST_QUEUE_H
+#define MPMC_SHARED_BROADCAST_QUEUE_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <cstring>     // For std::memcpy
+#include <new>         // For placement new
+#include <type_traits> // For std::is_trivially_copyable
+
+namespace sq
+{
+  // Single-Producer and Multi-Consumer broadcast ring. The producer writes
+  // every item once and each subscribed consumer reads it through its own
+  // cursor, so every consumer sees every item.
+  //
+  // enqueue() is gated by the slowest subscribed consumer and fails instead of
+  // overwriting unread items. enqueue_overwrite() never waits; consumers that
+  // fall more than Capacity items behind skip ahead and are told how many
+  // items they lost through the slot sequence numbers.
+  template <typename T, std::size_t Capacity, std::size_t Max_Consumers>
+  class Shared_Broadcast_Queue
+  {
+  private:
+    static_assert(Capacity > 0, "Capacity must be greater than zero");
+    static_assert(Max_Consumers > 0, "Max_Consumers must be greater than zero");
+    static_assert(std::is_trivially_copyable<T>::value,
+      "Consumers may read a slot while it is overwritten, T must be trivially copyable");
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    struct alignas(64) Buffer_Slot
+    {
+      std::atomic<std::size_t> sequence; // Position + 1 of the stored item, 0 while writing
+      T data;
+    };
+
+    // One per consumer, each on its own cache line
+    struct Consumer_Cursor
+    {
+      std::atomic<std::size_t> position;   // Next position to read
+      std::atomic<bool> active;            // Claimed by a subscriber
+      char padding[cache_line_size - sizeof(std::atomic<std::size_t>) - sizeof(std::atomic<bool>)];
+    };
+
+    struct Shared_Control_Block
+    {
+      std::atomic<std::size_t> tail;       // Producer position
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer
+      std::size_t max_consumers{ 0 };      // Number of consumer cursors
+      char capacity_padding[cache_line_size - (sizeof(std::size_t) * 2)];
+      Consumer_Cursor consumers[Max_Consumers];
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    Buffer_Slot* buffer{ nullptr };                 // Circular buffer slots
+
+    std::size_t min_cache{ 0 }; // Producer's copy of the slowest consumer position
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity;
+    }
+
+    constexpr static std::size_t aligned_control_size()
+    {
+      return (sizeof(Shared_Control_Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    // Position of the slowest active consumer, or pos if there are none
+    std::size_t slowest_consumer(std::size_t pos) const
+    {
+      std::size_t slowest = pos;
+
+      for (std::size_t i = 0; i < Max_Consumers; ++i)
+      {
+        const Consumer_Cursor& cursor = this->control_block->consumers[i];
+
+        if (cursor.active.load(std::memory_order_acquire))
+        {
+          std::size_t position = cursor.position.load(std::memory_order_acquire);
+
+          if (pos - position > pos - slowest)
+          {
+            slowest = position;
+          }
+        }
+      }
+
+      return slowest;
+    }
+
+    void write_slot(std::size_t pos, const T& item)
+    {
+      Buffer_Slot& slot = this->buffer[wrap(pos)];
+
+      // Mark the slot as being written so readers of the previous lap retry
+      slot.sequence.store(0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      std::memcpy(&slot.data, &item, sizeof(T));
+      slot.sequence.store(pos + 1, std::memory_order_release);
+
+      this->control_block->tail.store(pos + 1, std::memory_order_release);
+    }
+
+  public:
+    constexpr static std::size_t required_size()
+    {
+      return aligned_control_size() + (sizeof(Buffer_Slot) * Capacity);
+    }
+
+    // Claim a consumer cursor. The new consumer sees items enqueued from now on.
+    // Returns false if all Max_Consumers cursors are taken.
+    bool subscribe(std::size_t* consumer)
+    {
+      for (std::size_t i = 0; i < Max_Consumers; ++i)
+      {
+        Consumer_Cursor& cursor = this->control_block->consumers[i];
+        bool expected = false;
+
+        if (cursor.active.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+        {
+          cursor.position.store(this->control_block->tail.load(std::memory_order_acquire), std::memory_order_release);
+          *consumer = i;
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // Release a consumer cursor so it no longer gates the producer
+    void unsubscribe(std::size_t consumer)
+    {
+      this->control_block->consumers[consumer].active.store(false, std::memory_order_release);
+    }
+
+    // Count of items not yet read by the given consumer (may exceed Capacity when it lagged)
+    std::size_t size(std::size_t consumer) const
+    {
+      std::size_t position = this->control_block->consumers[consumer].position.load(std::memory_order_acquire);
+      return this->control_block->tail.load(std::memory_order_acquire) - position;
+    }
+
+    // Check if the given consumer has nothing left to read
+    bool is_empty(std::size_t consumer) const
+    {
+      return (this->size(consumer) == 0);
+    }
+
+    // Enqueue a new item for all consumers. Must only be called by the producer.
+    // Returns false if the slowest consumer has not yet read the slot being reused.
+    bool enqueue(const T& item)
+    {
+      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
+
+      if (pos - this->min_cache >= Capacity)
+      {
+        // Looks full; refresh our view of the slowest consumer
+        this->min_cache = this->slowest_consumer(pos);
+
+        if (pos - this->min_cache >= Capacity)
+        {
+          return false;
+        }
+      }
+
+      this->write_slot(pos, item);
+      return true;
+    }
+
+    // Enqueue a new item for all consumers, overwriting the oldest one
+    // regardless of whether it was read. Must only be called by the producer.
+    void enqueue_overwrite(const T& item)
+    {
+      this->write_slot(this->control_block->tail.load(std::memory_order_relaxed), item);
+    }
+
+    // Dequeue the next item for the given consumer.
+    // If lost is not null it receives the number of items that were
+    // overwritten before this consumer could read them.
+    bool dequeue(std::size_t consumer, T* item, std::size_t* lost = nullptr)
+    {
+      Consumer_Cursor& cursor = this->control_block->consumers[consumer];
+      std::size_t pos = cursor.position.load(std::memory_order_relaxed);
+      std::size_t skipped = 0;
+      bool success = false;
+
+      while (true)
+      {
+        std::size_t tail = this->control_block->tail.load(std::memory_order_acquire);
+
+        if (pos == tail)
+        {
+          break;
+        }
+
+        // Everything older than tail - Capacity has been overwritten
+        if (tail - pos > Capacity)
+        {
+          skipped += tail - Capacity - pos;
+          pos = tail - Capacity;
+        }
+
+        Buffer_Slot& slot = this->buffer[wrap(pos)];
+        std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if (sequence == pos + 1)
+        {
+          std::memcpy(item, &slot.data, sizeof(T));
+          std::atomic_thread_fence(std::memory_order_acquire);
+
+          if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+          {
+            ++pos;
+            success = true;
+            break;
+          }
+        }
+
+        // Overwritten by a later lap while we were reading it
+        ++skipped;
+        ++pos;
+      }
+
+      if (lost != nullptr)
+      {
+        *lost = skipped;
+      }
+
+      cursor.position.store(pos, std::memory_order_release);
+      return success;
+    }
+
+    // Create queue. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Broadcast_Queue<T, Capacity, Max_Consumers>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->buffer = reinterpret_cast<Buffer_Slot*>(
+        static_cast<char*>(shared_memory) + aligned_control_size()
+        );
+
+      if (this->control_block->capacity != Capacity ||
+          this->control_block->max_consumers != Max_Consumers)
+      {
+        // Initialize control block and buffer
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->tail.store(0, std::memory_order_relaxed);
+        this->control_block->capacity = Capacity;
+        this->control_block->max_consumers = Max_Consumers;
+
+        for (std::size_t i = 0; i < Max_Consumers; ++i)
+        {
+          this->control_block->consumers[i].position.store(0, std::memory_order_relaxed);
+          this->control_block->consumers[i].active.store(false, std::memory_order_relaxed);
+        }
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+          new (&this->buffer[i]) Buffer_Slot();
+          this->buffer[i].sequence.store(0, std::memory_order_relaxed);
+        }
+      }
+
+      this->min_cache = this->control_block->tail.load(std::memory_order_acquire);
+      this->min_cache = this->slowest_consumer(this->min_cache);
+
+      return true;
+    }
+
+    explicit Shared_Broadcast_Queue(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Broadcast_Queue() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_BROADCAST_QUEUE_H
@@ -0,0 +1,312 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_BYTE_QUEUE_H
+#define MPMC_SHARED_BYTE_QUEUE_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <cstring>     // For std::memcpy, std::memset
+#include <new>         // For placement new
+
+namespace sq
+{
+  // Multi-Producer and Multi-Consumer queue of variable-length messages.
+  // Messages are stored contiguously as length-prefixed records in a byte
+  // ring, so memory use follows the actual message sizes. A record that
+  // would straddle the end of the ring is preceded by a padding record and
+  // placed at the start instead.
+  //
+  // Producers reserve space with a CAS on tail and consumers claim records
+  // with a CAS on read. Space is handed back to producers in ring order by
+  // whichever consumer finishes the oldest outstanding record; released space
+  // is zeroed so a header that is reserved but not yet written reads as free.
+  // Headers carry the free-running position of their record, so a header
+  // left over from an earlier lap is never mistaken for the current one.
+  template <std::size_t Capacity_Bytes>
+  class Shared_Byte_Queue
+  {
+  private:
+    static constexpr std::size_t cache_line_size = 64;
+
+    enum Record_State : std::size_t
+    {
+      record_free = 0,      // Not written yet
+      record_committed = 1, // Holds a message
+      record_padding = 2,   // Filler up to the end of the ring
+      record_consumed = 3,  // Read, waiting for its space to be released
+      record_state_mask = 3
+    };
+
+    struct Record_Header
+    {
+      std::atomic<std::size_t> tag;        // Position of the record | Record_State; 0 while free
+      std::size_t size;                    // Payload size in bytes
+    };
+
+    // Records start at multiples of this, which leaves the low bits of a
+    // position free for the state and always leaves room for a padding header
+    static constexpr std::size_t record_alignment = sizeof(Record_Header);
+
+    static_assert(Capacity_Bytes >= 4 * record_alignment, "Capacity_Bytes is too small");
+    static_assert(Capacity_Bytes % record_alignment == 0, "Capacity_Bytes must be a multiple of 2 * sizeof(std::size_t)");
+
+    struct Shared_Control_Block
+    {
+      std::atomic<std::size_t> head;       // Start of the oldest unreleased record
+      char head_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::atomic<std::size_t> read;       // Start of the next record to claim
+      char read_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::atomic<std::size_t> tail;       // End of the last reserved record
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer in bytes
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    char* buffer{ nullptr };                        // Circular byte buffer
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity_Bytes;
+    }
+
+    constexpr static std::size_t aligned_control_size()
+    {
+      return (sizeof(Shared_Control_Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    // Bytes taken by a record of size payload bytes
+    constexpr static std::size_t record_length(std::size_t size)
+    {
+      return sizeof(Record_Header) + ((size + record_alignment - 1) & ~(record_alignment - 1));
+    }
+
+    Record_Header* header_at(std::size_t pos) const
+    {
+      return reinterpret_cast<Record_Header*>(this->buffer + wrap(pos));
+    }
+
+    static char* payload_of(Record_Header* header)
+    {
+      return reinterpret_cast<char*>(header) + sizeof(Record_Header);
+    }
+
+    // Mark the claimed record at pos as read and release whatever can be released
+    void finish_record(Record_Header* header, std::size_t pos)
+    {
+      header->tag.store(pos | record_consumed, std::memory_order_seq_cst);
+
+      while (true)
+      {
+        std::size_t head = this->control_block->head.load(std::memory_order_seq_cst);
+        Record_Header* oldest = this->header_at(head);
+        std::size_t tag = head | record_consumed;
+
+        // Only one consumer can take the record at head, and it alone moves
+        // head. The tag includes the position, so a stale head (whose record
+        // was released and its space reused) fails here instead of matching
+        // a later record at the same offset.
+        if (!oldest->tag.compare_exchange_strong(tag, record_free, std::memory_order_seq_cst))
+        {
+          return;
+        }
+
+        std::size_t length = record_length(oldest->size);
+
+        std::memset(reinterpret_cast<char*>(oldest) + sizeof(std::atomic<std::size_t>), 0,
+          length - sizeof(std::atomic<std::size_t>));
+
+        this->control_block->head.store(head + length, std::memory_order_seq_cst);
+      }
+    }
+
+  public:
+    // Largest message that always fits, including its header and worst case padding
+    constexpr static std::size_t max_message_size()
+    {
+      return ((Capacity_Bytes / 2) & ~(record_alignment - 1)) - sizeof(Record_Header);
+    }
+
+    constexpr static std::size_t required_size()
+    {
+      return aligned_control_size() + Capacity_Bytes;
+    }
+
+    // Check if there are no unclaimed records
+    bool is_empty() const
+    {
+      return (this->control_block->read.load(std::memory_order_acquire) ==
+              this->control_block->tail.load(std::memory_order_acquire));
+    }
+
+    // Count of bytes in use, including headers and padding
+    std::size_t size() const
+    {
+      std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+      std::size_t tail = this->control_block->tail.load(std::memory_order_acquire);
+      return tail - head;
+    }
+
+    // Enqueue a message of size bytes.
+    // Returns false if there is not enough free space or the message is too large.
+    bool enqueue(const void* data, std::size_t size)
+    {
+      if (size > max_message_size())
+      {
+        return false;
+      }
+
+      std::size_t length = record_length(size);
+      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
+      std::size_t padding = 0;
+
+      while (true)
+      {
+        // Records never straddle the end of the ring
+        std::size_t remaining = Capacity_Bytes - wrap(pos);
+        padding = (remaining < length) ? remaining : 0;
+
+        std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+
+        if (pos + padding + length - head > Capacity_Bytes)
+        {
+          // Full, unless pos went stale and consumers moved head past it;
+          // only a tail that has not moved since head was read proves it
+          std::size_t current = this->control_block->tail.load(std::memory_order_acquire);
+
+          if (current == pos)
+          {
+            return false;
+          }
+
+          pos = current;
+          continue;
+        }
+
+        if (this->control_block->tail.compare_exchange_weak(pos, pos + padding + length, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+
+      if (padding != 0)
+      {
+        Record_Header* filler = this->header_at(pos);
+        filler->size = padding - sizeof(Record_Header);
+        filler->tag.store(pos | record_padding, std::memory_order_release);
+        pos += padding;
+      }
+
+      Record_Header* header = this->header_at(pos);
+      std::memcpy(payload_of(header), data, size);
+      header->size = size;
+      header->tag.store(pos | record_committed, std::memory_order_release);
+
+      return true;
+    }
+
+    // Dequeue the next message into data, which can hold max_size bytes, and
+    // store its size in *size. Returns false if the next message is not
+    // committed yet, or if it is larger than max_size; in that case *size
+    // holds the required size and the message stays queued.
+    bool dequeue(void* data, std::size_t max_size, std::size_t* size)
+    {
+      std::size_t pos = this->control_block->read.load(std::memory_order_acquire);
+      Record_Header* header = nullptr;
+
+      while (true)
+      {
+        if (pos == this->control_block->tail.load(std::memory_order_acquire))
+        {
+          *size = 0;
+          return false;
+        }
+
+        header = this->header_at(pos);
+        std::size_t tag = header->tag.load(std::memory_order_acquire);
+
+        // A header of another lap reads as not written yet
+        std::size_t state = ((tag & ~std::size_t(record_state_mask)) == pos) ? (tag & record_state_mask) : record_free;
+
+        std::size_t payload = header->size;
+        bool readable = (state == record_committed && payload <= max_size) || state == record_padding;
+
+        if (!readable)
+        {
+          // Either not committed yet, too large, or claimed by another consumer
+          std::size_t current = this->control_block->read.load(std::memory_order_acquire);
+
+          if (current != pos)
+          {
+            pos = current;
+            continue;
+          }
+
+          *size = (state == record_committed) ? payload : 0;
+          return false;
+        }
+
+        std::size_t length = record_length(payload);
+
+        if (!this->control_block->read.compare_exchange_weak(pos, pos + length, std::memory_order_acq_rel))
+        {
+          continue;
+        }
+
+        if (state == record_padding)
+        {
+          this->finish_record(header, pos);
+          pos += length;
+          continue;
+        }
+
+        break;
+      }
+
+      *size = header->size;
+      std::memcpy(data, payload_of(header), *size);
+      this->finish_record(header, pos);
+
+      return true;
+    }
+
+    // Create queue. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Byte_Queue<Capacity_Bytes>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->buffer = static_cast<char*>(shared_memory) + aligned_control_size();
+
+      if (this->control_block->capacity != Capacity_Bytes)
+      {
+        // Initialize control block and buffer
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->head.store(0, std::memory_order_relaxed);
+        this->control_block->read.store(0, std::memory_order_relaxed);
+        this->control_block->tail.store(0, std::memory_order_relaxed);
+        this->control_block->capacity = Capacity_Bytes;
+
+        for (std::size_t pos = 0; pos < Capacity_Bytes; pos += sizeof(Record_Header))
+        {
+          Record_Header* header = new (this->buffer + pos) Record_Header();
+          header->tag.store(record_free, std::memory_order_relaxed);
+          header->size = 0;
+        }
+      }
+
+      return true;
+    }
+
+    explicit Shared_Byte_Queue(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Byte_Queue() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_BYTE_QUEUE_H
@@ -0,0 +1,369 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_GROUP_QUEUE_H
+#define MPMC_SHARED_GROUP_QUEUE_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <new>         // For placement new
+#include <thread>      // For std::this_thread::yield
+
+// Spins on a slot that another thread is still writing or reading before
+// yielding the CPU to it
+#ifndef SQ_SPIN_LIMIT
+#define SQ_SPIN_LIMIT 128
+#endif
+
+// Spins join() waits for another worker to activate the group before it
+// assumes that worker died and activates the group itself
+#ifndef SQ_JOIN_WAIT_LIMIT
+#define SQ_JOIN_WAIT_LIMIT (SQ_SPIN_LIMIT * 1024)
+#endif
+
+namespace sq
+{
+  // Single-Producer ring with consumer groups. Every group receives every
+  // item exactly once and the workers of a group share the load by claiming
+  // items through the group's atomic cursor. The producer is gated by the
+  // slowest group, and within a group by the oldest item still being read.
+  //
+  // A group keeps its place in the ring while it has no workers, so a worker
+  // pool can restart without losing items. Call remove_group() to stop a
+  // group from gating the producer.
+  template <typename T, std::size_t Capacity, std::size_t Max_Groups, std::size_t Max_Workers>
+  class Shared_Group_Queue
+  {
+  private:
+    static_assert(Capacity > 0, "Capacity must be greater than zero");
+    static_assert(Max_Groups > 0, "Max_Groups must be greater than zero");
+    static_assert(Max_Workers > 0, "Max_Workers must be greater than zero");
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    enum Group_State : unsigned
+    {
+      group_inactive = 0,
+      group_initializing = 1,
+      group_active = 2
+    };
+
+    struct alignas(64) Buffer_Slot
+    {
+      T data;
+    };
+
+    // One per worker, each on its own cache line
+    struct Worker_Cursor
+    {
+      std::atomic<std::size_t> position;   // Every item below this that the worker claimed is done
+      std::atomic<bool> active;            // Claimed by a worker
+      char padding[cache_line_size - sizeof(std::atomic<std::size_t>) - sizeof(std::atomic<bool>)];
+    };
+
+    struct Group_Cursor
+    {
+      std::atomic<std::size_t> next;       // Next item to be claimed by the group
+      std::atomic<unsigned> state;         // Group_State
+      char padding[cache_line_size - sizeof(std::atomic<std::size_t>) - sizeof(std::atomic<unsigned>)];
+      Worker_Cursor workers[Max_Workers];
+    };
+
+    struct Shared_Control_Block
+    {
+      std::atomic<std::size_t> tail;       // Producer position
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer
+      std::size_t max_groups{ 0 };         // Number of group cursors
+      std::size_t max_workers{ 0 };        // Number of worker cursors per group
+      char capacity_padding[cache_line_size - (sizeof(std::size_t) * 3)];
+      Group_Cursor groups[Max_Groups];
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    Buffer_Slot* buffer{ nullptr };                 // Circular buffer slots
+
+    std::size_t min_cache{ 0 }; // Producer's copy of the slowest group position
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity;
+    }
+
+    constexpr static std::size_t aligned_control_size()
+    {
+      return (sizeof(Shared_Control_Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    // Oldest item still needed by any active group, or pos if there are none
+    std::size_t slowest_group(std::size_t pos) const
+    {
+      std::size_t slowest = pos;
+
+      for (std::size_t i = 0; i < Max_Groups; ++i)
+      {
+        const Group_Cursor& group = this->control_block->groups[i];
+
+        if (group.state.load(std::memory_order_acquire) != group_active)
+        {
+          continue;
+        }
+
+        // Workers publish their position before claiming, so reading them
+        // first can only make the result older than necessary
+        for (std::size_t j = 0; j < Max_Workers; ++j)
+        {
+          const Worker_Cursor& worker = group.workers[j];
+
+          if (worker.active.load(std::memory_order_acquire))
+          {
+            std::size_t position = worker.position.load(std::memory_order_acquire);
+
+            if (pos - position > pos - slowest)
+            {
+              slowest = position;
+            }
+          }
+        }
+
+        std::size_t next = group.next.load(std::memory_order_acquire);
+
+        if (pos - next > pos - slowest)
+        {
+          slowest = next;
+        }
+      }
+
+      return slowest;
+    }
+
+    // Start the group at the current tail. previous is the group's position
+    // read before it left group_inactive; nobody claims until the group is
+    // active, so next only differs from it once another worker already did
+    // this (then both results are equally valid) or claims began (then this
+    // late call must not move next back).
+    void activate(Group_Cursor& cursor, std::size_t previous)
+    {
+      unsigned state = group_initializing;
+
+      cursor.next.compare_exchange_strong(previous, this->control_block->tail.load(std::memory_order_acquire),
+        std::memory_order_acq_rel);
+      cursor.state.compare_exchange_strong(state, group_active, std::memory_order_acq_rel);
+    }
+
+  public:
+    constexpr static std::size_t required_size()
+    {
+      return aligned_control_size() + (sizeof(Buffer_Slot) * Capacity);
+    }
+
+    // Join a group as a new worker. Activates the group if needed, in which
+    // case it starts with items enqueued from now on. If the worker
+    // activating the group does not finish within SQ_JOIN_WAIT_LIMIT spins
+    // (it died or is stalled), join() activates the group itself.
+    // Returns false if the group already has Max_Workers workers.
+    bool join(std::size_t group, std::size_t* worker)
+    {
+      Group_Cursor& cursor = this->control_block->groups[group];
+      std::size_t previous = cursor.next.load(std::memory_order_acquire);
+      unsigned state = group_inactive;
+
+      if (cursor.state.compare_exchange_strong(state, group_initializing, std::memory_order_acq_rel))
+      {
+        this->activate(cursor, previous);
+      }
+      else
+      {
+        std::size_t spins = 0;
+
+        // Another worker is activating the group
+        while (cursor.state.load(std::memory_order_acquire) == group_initializing)
+        {
+          if (++spins >= SQ_JOIN_WAIT_LIMIT)
+          {
+            this->activate(cursor, cursor.next.load(std::memory_order_acquire));
+          }
+          else if (spins % SQ_SPIN_LIMIT == 0)
+          {
+            std::this_thread::yield();
+          }
+        }
+      }
+
+      for (std::size_t i = 0; i < Max_Workers; ++i)
+      {
+        Worker_Cursor& candidate = cursor.workers[i];
+        bool expected = false;
+
+        if (candidate.active.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+        {
+          candidate.position.store(cursor.next.load(std::memory_order_acquire), std::memory_order_release);
+          *worker = i;
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // Leave a group. The group itself stays active.
+    void leave(std::size_t group, std::size_t worker)
+    {
+      this->control_block->groups[group].workers[worker].active.store(false, std::memory_order_release);
+    }
+
+    // Stop a group from receiving items and gating the producer
+    void remove_group(std::size_t group)
+    {
+      this->control_block->groups[group].state.store(group_inactive, std::memory_order_release);
+    }
+
+    // Count of items the group has not claimed yet
+    std::size_t size(std::size_t group) const
+    {
+      std::size_t next = this->control_block->groups[group].next.load(std::memory_order_acquire);
+      return this->control_block->tail.load(std::memory_order_acquire) - next;
+    }
+
+    // Check if the group has nothing left to claim
+    bool is_empty(std::size_t group) const
+    {
+      return (this->size(group) == 0);
+    }
+
+    // Enqueue a new item for all groups. Must only be called by the producer.
+    // Returns false if the slowest group still needs the slot being reused.
+    bool enqueue(const T& item)
+    {
+      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
+
+      if (pos - this->min_cache >= Capacity)
+      {
+        // Looks full; refresh our view of the slowest group
+        this->min_cache = this->slowest_group(pos);
+
+        if (pos - this->min_cache >= Capacity)
+        {
+          return false;
+        }
+      }
+
+      this->buffer[wrap(pos)].data = item;
+      this->control_block->tail.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Claim the group's next item for in place processing by this worker.
+    // The item stays valid until release() or the worker's next claim.
+    // Returns false if the group has nothing left to claim.
+    bool claim(std::size_t group, std::size_t worker, std::size_t* sequence)
+    {
+      Group_Cursor& cursor = this->control_block->groups[group];
+      Worker_Cursor& self = cursor.workers[worker];
+      std::size_t next = cursor.next.load(std::memory_order_acquire);
+
+      while (true)
+      {
+        // Everything we claimed before next is done; hold next while we try to take it
+        self.position.store(next, std::memory_order_release);
+
+        if (next == this->control_block->tail.load(std::memory_order_acquire))
+        {
+          return false;
+        }
+
+        if (cursor.next.compare_exchange_weak(next, next + 1, std::memory_order_acq_rel))
+        {
+          *sequence = next;
+          return true;
+        }
+      }
+    }
+
+    // Item claimed through claim()
+    T& at(std::size_t sequence)
+    {
+      return this->buffer[wrap(sequence)].data;
+    }
+
+    // Mark the worker's claimed item as done so the producer may reuse its slot
+    void release(std::size_t group, std::size_t worker, std::size_t sequence)
+    {
+      this->control_block->groups[group].workers[worker].position.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Claim, copy and release the group's next item in one go
+    bool dequeue(std::size_t group, std::size_t worker, T* item)
+    {
+      std::size_t sequence = 0;
+
+      if (!this->claim(group, worker, &sequence))
+      {
+        return false;
+      }
+
+      *item = this->at(sequence);
+      this->release(group, worker, sequence);
+
+      return true;
+    }
+
+    // Create queue. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Group_Queue<T, Capacity, Max_Groups, Max_Workers>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->buffer = reinterpret_cast<Buffer_Slot*>(
+        static_cast<char*>(shared_memory) + aligned_control_size()
+        );
+
+      if (this->control_block->capacity != Capacity ||
+          this->control_block->max_groups != Max_Groups ||
+          this->control_block->max_workers != Max_Workers)
+      {
+        // Initialize control block and buffer
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->tail.store(0, std::memory_order_relaxed);
+        this->control_block->capacity = Capacity;
+        this->control_block->max_groups = Max_Groups;
+        this->control_block->max_workers = Max_Workers;
+
+        for (std::size_t i = 0; i < Max_Groups; ++i)
+        {
+          Group_Cursor& group = this->control_block->groups[i];
+          group.next.store(0, std::memory_order_relaxed);
+          group.state.store(group_inactive, std::memory_order_relaxed);
+
+          for (std::size_t j = 0; j < Max_Workers; ++j)
+          {
+            group.workers[j].position.store(0, std::memory_order_relaxed);
+            group.workers[j].active.store(false, std::memory_order_relaxed);
+          }
+        }
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+          new (&this->buffer[i]) Buffer_Slot();
+        }
+      }
+
+      this->min_cache = this->control_block->tail.load(std::memory_order_acquire);
+      this->min_cache = this->slowest_group(this->min_cache);
+
+      return true;
+    }
+
+    explicit Shared_Group_Queue(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Group_Queue() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_GROUP_QUEUE_H
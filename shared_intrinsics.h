@@ -0,0 +1,320 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_INTRINSICS_H
+#define MPMC_SHARED_INTRINSICS_H
+
+#include <chrono>      // For std::chrono::steady_clock
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uintptr_t, std::uint64_t
+#include <cstring>     // For std::memcpy
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SQ_HAS_SSE2 1
+#include <emmintrin.h> // For _mm_stream_si128, _mm_sfence, _mm_prefetch
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SQ_HAS_X86_DISPATCH 1
+#include <immintrin.h> // For AVX2 and AVX-512 intrinsics, selected at runtime
+#endif
+
+#if defined(SQ_LATENCY_USE_TSC) && defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>    // For __rdtsc
+#endif
+
+// How many slots ahead consumers prefetch; 0 disables prefetching
+#ifndef SQ_PREFETCH_DISTANCE
+#define SQ_PREFETCH_DISTANCE 2
+#endif
+
+// Memory helpers shared by the queues. Everything here has a portable
+// fallback, so callers never need to check for the instruction set.
+namespace sq
+{
+  namespace detail
+  {
+    // Copy size bytes with non-temporal (streaming) stores where available.
+    // The destination lines are written around the cache instead of being
+    // pulled in exclusive state, which pays off for large payloads that are
+    // read by another core next. Call stream_fence() before publishing.
+    inline void stream_copy(void* destination, const void* source, std::size_t size)
+    {
+#if defined(SQ_HAS_SSE2)
+      char* out = static_cast<char*>(destination);
+      const char* in = static_cast<const char*>(source);
+
+      // Streaming stores need 16 byte aligned destinations; slots normally are
+      std::size_t misalignment = reinterpret_cast<std::uintptr_t>(out) & 15;
+
+      if (misalignment != 0)
+      {
+        std::size_t head = (16 - misalignment < size) ? 16 - misalignment : size;
+        std::memcpy(out, in, head);
+        out += head;
+        in += head;
+        size -= head;
+      }
+
+      while (size >= 64)
+      {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out + 48), d);
+        out += 64;
+        in += 64;
+        size -= 64;
+      }
+
+      while (size >= 16)
+      {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(out), _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+        out += 16;
+        in += 16;
+        size -= 16;
+      }
+
+      if (size != 0)
+      {
+        std::memcpy(out, in, size);
+      }
+#else
+      std::memcpy(destination, source, size);
+#endif
+    }
+
+    // Hint that the cache lines of [address, address + size) will be read soon
+    inline void prefetch_read(const void* address, std::size_t size)
+    {
+      const char* line = static_cast<const char*>(address);
+
+      for (std::size_t offset = 0; offset < size; offset += 64)
+      {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(line + offset, 0, 3);
+#elif defined(SQ_HAS_SSE2)
+        _mm_prefetch(line + offset, _MM_HINT_T0);
+#else
+        (void)line;
+#endif
+      }
+    }
+
+    // Hint that the cache lines of [address, address + size) will be written soon
+    inline void prefetch_write(const void* address, std::size_t size)
+    {
+      const char* line = static_cast<const char*>(address);
+
+      for (std::size_t offset = 0; offset < size; offset += 64)
+      {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(line + offset, 1, 3);
+#elif defined(SQ_HAS_SSE2)
+        _mm_prefetch(line + offset, _MM_HINT_T0);
+#else
+        (void)line;
+#endif
+      }
+    }
+
+    // Order preceding streaming stores before any later store, such as the
+    // one publishing the data. Release semantics alone do not cover them.
+    inline void stream_fence()
+    {
+#if defined(SQ_HAS_SSE2)
+      _mm_sfence();
+#endif
+    }
+
+    // steady_clock nanoseconds; CLOCK_MONOTONIC on Linux, so comparable
+    // between processes on the same machine
+    inline std::uint64_t steady_ns()
+    {
+      return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Timestamp for latency measurements: steady_ns() by default, or raw TSC
+    // ticks when SQ_LATENCY_USE_TSC is defined on x86. The TSC is cheaper to
+    // read but its rate is CPU specific and it is only comparable across
+    // cores when invariant.
+    inline std::uint64_t read_clock()
+    {
+#if defined(SQ_LATENCY_USE_TSC) && (defined(SQ_HAS_X86_DISPATCH) || defined(_M_X64) || defined(_M_IX86))
+      return __rdtsc();
+#else
+      return steady_ns();
+#endif
+    }
+
+    // Index of the highest set bit; value must not be 0
+    inline unsigned highest_bit(std::uint64_t value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+      unsigned bit = 0;
+
+      while (value >>= 1)
+      {
+        ++bit;
+      }
+
+      return bit;
+#endif
+    }
+
+    // Gather kernels: copy count elements of element_size bytes, spaced
+    // stride bytes apart in source (one per slot), densely into destination.
+    using Gather_Copy = void (*)(void*, const void*, std::size_t, std::size_t, std::size_t);
+
+    inline void gather_copy_scalar(void* destination, const void* source, std::size_t count,
+      std::size_t element_size, std::size_t stride)
+    {
+      char* out = static_cast<char*>(destination);
+      const char* in = static_cast<const char*>(source);
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        if (SQ_PREFETCH_DISTANCE != 0 && i + SQ_PREFETCH_DISTANCE < count)
+        {
+          prefetch_read(in + ((i + SQ_PREFETCH_DISTANCE) * stride), element_size);
+        }
+
+        std::memcpy(out + (i * element_size), in + (i * stride), element_size);
+      }
+    }
+
+#if defined(SQ_HAS_X86_DISPATCH)
+    // Requires element_size <= 32, stride >= 32, and 32 readable bytes from
+    // the start of every element within its stride. Each element is moved
+    // with one 32 byte load and store; the bytes past the element are
+    // overwritten by the next store, and the elements whose store would run
+    // past the end of destination are copied with memcpy.
+    __attribute__((target("avx2")))
+    inline void gather_copy_avx2(void* destination, const void* source, std::size_t count,
+      std::size_t element_size, std::size_t stride)
+    {
+      char* out = static_cast<char*>(destination);
+      const char* in = static_cast<const char*>(source);
+      std::size_t total = count * element_size;
+      std::size_t vector_count = (total >= 32) ? ((total - 32) / element_size) + 1 : 0;
+      std::size_t i = 0;
+
+      for (; i < vector_count; ++i)
+      {
+        if (SQ_PREFETCH_DISTANCE != 0 && i + SQ_PREFETCH_DISTANCE < count)
+        {
+          __builtin_prefetch(in + ((i + SQ_PREFETCH_DISTANCE) * stride), 0, 3);
+        }
+
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + (i * stride)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + (i * element_size)), value);
+      }
+
+      for (; i < count; ++i)
+      {
+        std::memcpy(out + (i * element_size), in + (i * stride), element_size);
+      }
+    }
+
+    // Requires element_size <= 32 and stride >= 32. Masked loads and stores
+    // touch exactly element_size bytes, so no element needs a scalar tail
+    // and nothing past an element is read.
+    __attribute__((target("avx512bw,avx512vl")))
+    inline void gather_copy_avx512(void* destination, const void* source, std::size_t count,
+      std::size_t element_size, std::size_t stride)
+    {
+      char* out = static_cast<char*>(destination);
+      const char* in = static_cast<const char*>(source);
+      __mmask32 mask = static_cast<__mmask32>((element_size == 32) ? 0xFFFFFFFFull : ((1ull << element_size) - 1));
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        if (SQ_PREFETCH_DISTANCE != 0 && i + SQ_PREFETCH_DISTANCE < count)
+        {
+          __builtin_prefetch(in + ((i + SQ_PREFETCH_DISTANCE) * stride), 0, 3);
+        }
+
+        __m256i value = _mm256_maskz_loadu_epi8(mask, in + (i * stride));
+        _mm256_mask_storeu_epi8(out + (i * element_size), mask, value);
+      }
+    }
+#endif
+
+    // Best gather kernel for the CPU we are running on
+    inline Gather_Copy select_gather_copy()
+    {
+#if defined(SQ_HAS_X86_DISPATCH)
+      __builtin_cpu_init();
+
+      if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+      {
+        return gather_copy_avx512;
+      }
+
+      if (__builtin_cpu_supports("avx2"))
+      {
+        return gather_copy_avx2;
+      }
+#endif
+
+      return gather_copy_scalar;
+    }
+
+    // Whether kernel reads 32 bytes per element whatever its size
+    inline bool reads_past_element(Gather_Copy kernel)
+    {
+#if defined(SQ_HAS_X86_DISPATCH)
+      return (kernel == gather_copy_avx2);
+#else
+      (void)kernel;
+      return false;
+#endif
+    }
+
+    // Kernel used by gather_copy(): the best one for this CPU unless
+    // override_gather_copy() replaced it
+    inline Gather_Copy& gather_copy_kernel()
+    {
+      static Gather_Copy kernel = select_gather_copy();
+      return kernel;
+    }
+
+    // Make gather_copy() use kernel, or the best one again for nullptr, e.g.
+    // to test every kernel the CPU supports. Call it while nothing gathers.
+    inline void override_gather_copy(Gather_Copy kernel)
+    {
+      gather_copy_kernel() = (kernel != nullptr) ? kernel : select_gather_copy();
+    }
+
+    // Copy count elements spaced stride bytes apart into a dense array.
+    // Each element starts element_offset bytes into its stride, so the
+    // bytes from there to the end of the stride belong to the same record.
+    // Small elements use the vector kernel selected on first use (see
+    // gather_copy_kernel()), unless it would read past the record of an
+    // element.
+    inline void gather_copy(void* destination, const void* source, std::size_t count,
+      std::size_t element_size, std::size_t stride, std::size_t element_offset)
+    {
+      Gather_Copy kernel = gather_copy_kernel();
+
+      if (element_size > 32 || stride < 32 || (reads_past_element(kernel) && element_offset + 32 > stride))
+      {
+        gather_copy_scalar(destination, source, count, element_size, stride);
+        return;
+      }
+
+      kernel(destination, source, count, element_size, stride);
+    }
+  } // namespace detail
+} // namespace sq
+
+#endif // MPMC_SHARED_INTRINSICS_H
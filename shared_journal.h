@@ -0,0 +1,881 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_JOURNAL_H
+#define MPMC_SHARED_JOURNAL_H
+
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint32_t, std::uint64_t
+#include <cstring>     // For std::memcpy, std::memset
+#include <memory>      // For std::unique_ptr
+#include <mutex>       // For std::mutex
+#include <thread>      // For std::thread
+#include <type_traits> // For std::is_trivially_copyable
+#include <vector>      // For std::vector
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN // Keep winsock, RPC and the like out of the including code
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX            // Keep min/max macros from breaking std::min and std::max
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>     // For open, O_DIRECT
+#include <sys/stat.h>  // For fstat
+#include <unistd.h>    // For pread, pwrite, ftruncate, fdatasync
+#include <cerrno>      // For errno, EINTR
+#endif
+
+namespace sq
+{
+  // Append-only journal of queue items, written by a background thread with
+  // large sequential writes.
+  //
+  // File layout: a journal_block_size header block (Journal_Header), then
+  // fixed-size records: a Journal_Record followed by the item bytes, padded
+  // to a multiple of 8. Records are numbered from 0 without gaps.
+
+  constexpr std::uint32_t journal_magic = 0x4A515153; // "SQQJ"
+  constexpr std::uint32_t journal_version = 1;
+  constexpr std::size_t journal_block_size = 4096;    // Alignment for direct I/O
+  constexpr std::size_t journal_drain_batch = 64;     // Items per dequeue_bulk() in Journal_Writer::drain()
+
+  struct Journal_Header
+  {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t item_size;
+    std::uint32_t record_size;
+    std::uint32_t header_size;
+  };
+
+  struct Journal_Record
+  {
+    std::uint64_t sequence;
+    std::uint32_t flags;    // journal_important
+    std::uint32_t checksum; // FNV-1a over sequence, flags and the item bytes
+  };
+
+  enum Journal_Flag : std::uint32_t
+  {
+    journal_important = 1u << 0
+  };
+
+  struct Journal_Options
+  {
+    std::size_t buffer_size{ 1 << 20 }; // Bytes per write, rounded up to journal_block_size; two are allocated
+    bool direct_io{ false };            // Bypass the page cache (O_DIRECT / FILE_FLAG_NO_BUFFERING) where supported
+    bool sync_data{ false };            // fdatasync / FlushFileBuffers after every write
+  };
+
+  namespace detail
+  {
+    inline std::uint32_t fnv1a(const void* data, std::size_t size, std::uint32_t hash = 2166136261u)
+    {
+      const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        hash = (hash ^ bytes[i]) * 16777619u;
+      }
+
+      return hash;
+    }
+
+    // Positioned reads and writes on a file handle
+    class Journal_File
+    {
+    private:
+#if defined(_WIN32)
+      HANDLE file{ INVALID_HANDLE_VALUE };
+#else
+      int file{ -1 };
+#endif
+
+    public:
+      bool open(const char* path, bool direct)
+      {
+        this->close();
+
+#if defined(_WIN32)
+        DWORD flags = FILE_ATTRIBUTE_NORMAL | (direct ? FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH : 0);
+        this->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, flags, NULL);
+        return (this->file != INVALID_HANDLE_VALUE);
+#else
+        int flags = O_RDWR | O_CREAT;
+
+#if defined(O_DIRECT)
+        flags |= direct ? O_DIRECT : 0;
+#else
+        (void)direct; // Not supported here; the page cache is used
+#endif
+
+        this->file = ::open(path, flags, 0644);
+        return (this->file != -1);
+#endif
+      }
+
+      void close()
+      {
+#if defined(_WIN32)
+        if (this->file != INVALID_HANDLE_VALUE)
+        {
+          CloseHandle(this->file);
+          this->file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (this->file != -1)
+        {
+          ::close(this->file);
+          this->file = -1;
+        }
+#endif
+      }
+
+      bool size(std::uint64_t* result) const
+      {
+#if defined(_WIN32)
+        LARGE_INTEGER size;
+
+        if (!GetFileSizeEx(this->file, &size))
+        {
+          return false;
+        }
+
+        *result = static_cast<std::uint64_t>(size.QuadPart);
+        return true;
+#else
+        struct stat status;
+
+        if (fstat(this->file, &status) != 0)
+        {
+          return false;
+        }
+
+        *result = static_cast<std::uint64_t>(status.st_size);
+        return true;
+#endif
+      }
+
+      // Returns the number of bytes read, which is short at the end of the file
+      std::size_t read_at(void* data, std::size_t size, std::uint64_t offset) const
+      {
+        std::size_t done = 0;
+
+        while (done < size)
+        {
+#if defined(_WIN32)
+          OVERLAPPED position{};
+          position.Offset = static_cast<DWORD>((offset + done) & 0xFFFFFFFF);
+          position.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+          DWORD count = 0;
+
+          if (!ReadFile(this->file, static_cast<char*>(data) + done, static_cast<DWORD>(size - done), &count, &position) ||
+            count == 0)
+          {
+            break;
+          }
+#else
+          ssize_t count = pread(this->file, static_cast<char*>(data) + done, size - done,
+            static_cast<off_t>(offset + done));
+
+          if (count < 0 && errno == EINTR)
+          {
+            continue;
+          }
+
+          if (count <= 0)
+          {
+            break;
+          }
+#endif
+
+          done += static_cast<std::size_t>(count);
+        }
+
+        return done;
+      }
+
+      bool write_at(const void* data, std::size_t size, std::uint64_t offset)
+      {
+        std::size_t done = 0;
+
+        while (done < size)
+        {
+#if defined(_WIN32)
+          OVERLAPPED position{};
+          position.Offset = static_cast<DWORD>((offset + done) & 0xFFFFFFFF);
+          position.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+          DWORD count = 0;
+
+          if (!WriteFile(this->file, static_cast<const char*>(data) + done, static_cast<DWORD>(size - done), &count,
+            &position))
+          {
+            return false;
+          }
+#else
+          ssize_t count = pwrite(this->file, static_cast<const char*>(data) + done, size - done,
+            static_cast<off_t>(offset + done));
+
+          if (count < 0 && errno == EINTR)
+          {
+            continue;
+          }
+
+          if (count <= 0)
+          {
+            return false;
+          }
+#endif
+
+          done += static_cast<std::size_t>(count);
+        }
+
+        return true;
+      }
+
+      bool truncate(std::uint64_t size)
+      {
+#if defined(_WIN32)
+        LARGE_INTEGER position;
+        position.QuadPart = static_cast<LONGLONG>(size);
+        return SetFilePointerEx(this->file, position, NULL, FILE_BEGIN) && SetEndOfFile(this->file);
+#else
+        return (ftruncate(this->file, static_cast<off_t>(size)) == 0);
+#endif
+      }
+
+      bool sync()
+      {
+#if defined(_WIN32)
+        return (FlushFileBuffers(this->file) != 0);
+#elif defined(__APPLE__)
+        return (fsync(this->file) == 0);
+#else
+        return (fdatasync(this->file) == 0);
+#endif
+      }
+
+      Journal_File() = default;
+      Journal_File(const Journal_File&) = delete;
+      Journal_File& operator=(const Journal_File&) = delete;
+
+      ~Journal_File()
+      {
+        this->close();
+      }
+    };
+  } // namespace detail
+
+  // Appends items to a journal file. Records are copied into one of two
+  // buffers; a full buffer is handed to a background thread that writes it
+  // with a single positioned write while the other one fills, so the caller
+  // only waits for the disk when both buffers are full.
+  //
+  // Typically owned by one dedicated consumer thread that calls drain() on a
+  // queue (and optionally forwards the items to another queue), which keeps
+  // disk latency away from the producers. Methods other than the
+  // constructors must be called from one thread at a time.
+  //
+  // Opening an existing journal appends to it: a torn record at the end
+  // (from a crash) is cut off and numbering continues after the last
+  // complete one.
+  template <typename T>
+  class Journal_Writer
+  {
+  private:
+    static_assert(std::is_trivially_copyable<T>::value, "Journal_Writer requires a trivially copyable T");
+
+    static constexpr std::size_t record_size =
+      (sizeof(Journal_Record) + sizeof(T) + 7) & ~static_cast<std::size_t>(7);
+
+    detail::Journal_File file;
+    Journal_Options options;
+    std::vector<unsigned char> memory;
+    unsigned char* buffers[2]{ nullptr, nullptr };
+    std::size_t buffer_capacity{ 0 };
+    int active{ 0 };
+    std::size_t active_length{ 0 };   // Bytes in the active buffer
+    std::size_t carried{ 0 };         // Leading bytes of the active buffer already written
+    std::uint64_t active_offset{ 0 }; // File offset of the active buffer, block aligned
+    std::uint64_t sequence{ 0 };      // Next record number
+
+    std::unique_ptr<T[]> drain_items;
+    std::unique_ptr<bool[]> drain_important;
+    std::size_t drain_count{ 0 };     // Items of the last batch taken by drain()
+    std::size_t drain_done{ 0 };      // Those of them journaled so far
+    std::uint64_t forward_drops{ 0 }; // Items drain() could not enqueue into forward
+
+    // Buffer handed to the writer thread
+    struct Pending_Write
+    {
+      unsigned char* data;
+      std::size_t length;
+      std::uint64_t offset;
+      std::uint64_t end_sequence;
+    };
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable condition;
+    Pending_Write pending{};
+    bool has_pending{ false };
+    bool stopping{ false };
+    bool failed{ false };
+    std::uint64_t written_sequence{ 0 }; // Records handed to the file (and synced with sync_data)
+
+    bool write_pending(Pending_Write job)
+    {
+      std::size_t length = job.length;
+
+      if (this->options.direct_io)
+      {
+        // Direct I/O writes whole blocks; pad the last one and cut the file back afterwards
+        length = (length + journal_block_size - 1) & ~(journal_block_size - 1);
+        std::memset(job.data + job.length, 0, length - job.length);
+      }
+
+      if (!this->file.write_at(job.data, length, job.offset))
+      {
+        return false;
+      }
+
+      if (length != job.length && !this->file.truncate(job.offset + job.length))
+      {
+        return false;
+      }
+
+      return !this->options.sync_data || this->file.sync();
+    }
+
+    void writer_loop()
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+
+      while (true)
+      {
+        this->condition.wait(lock, [this]() { return this->has_pending || this->stopping; });
+
+        if (!this->has_pending)
+        {
+          return;
+        }
+
+        Pending_Write job = this->pending;
+        lock.unlock();
+
+        bool written = this->write_pending(job);
+
+        lock.lock();
+        this->has_pending = false;
+        this->failed = this->failed || !written;
+        this->written_sequence = written ? job.end_sequence : this->written_sequence;
+        this->condition.notify_all();
+      }
+    }
+
+    // Hand the active buffer to the writer thread and switch to the other
+    // one. A partial last block is carried over, so the next write starts
+    // at an aligned offset and rewrites it. Returns false after a write error.
+    bool submit(bool wait)
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this]() { return !this->has_pending; });
+
+      if (this->failed)
+      {
+        return false;
+      }
+
+      if (this->active_length != this->carried)
+      {
+        unsigned char* data = this->buffers[this->active];
+        std::size_t keep = this->active_length % journal_block_size;
+        std::size_t whole = this->active_length - keep;
+
+        std::memcpy(this->buffers[this->active ^ 1], data + whole, keep);
+
+        this->pending = Pending_Write{ data, this->active_length, this->active_offset, this->sequence };
+        this->has_pending = true;
+        this->condition.notify_all();
+
+        this->active ^= 1;
+        this->active_offset += whole;
+        this->active_length = keep;
+        this->carried = keep;
+      }
+
+      if (wait)
+      {
+        this->condition.wait(lock, [this]() { return !this->has_pending; });
+      }
+
+      return !this->failed;
+    }
+
+    bool put(const void* data, std::size_t size)
+    {
+      const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+      while (size != 0)
+      {
+        std::size_t room = this->buffer_capacity - this->active_length;
+        std::size_t count = (size < room) ? size : room;
+
+        std::memcpy(this->buffers[this->active] + this->active_length, bytes, count);
+        this->active_length += count;
+        bytes += count;
+        size -= count;
+
+        if (this->active_length == this->buffer_capacity && !this->submit(false))
+        {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    bool record_is_valid(const unsigned char* record) const
+    {
+      Journal_Record header;
+      std::memcpy(&header, record, sizeof(header));
+
+      std::uint32_t checksum = detail::fnv1a(&header.sequence, sizeof(header.sequence));
+      checksum = detail::fnv1a(&header.flags, sizeof(header.flags), checksum);
+      checksum = detail::fnv1a(record + sizeof(Journal_Record), sizeof(T), checksum);
+
+      return (header.checksum == checksum);
+    }
+
+    // Validate or write the header, drop a torn tail and find the next
+    // record number. Leaves the file size at the end of the last record.
+    bool prepare_file(std::uint64_t* end)
+    {
+      std::uint64_t size = 0;
+
+      if (!this->file.size(&size))
+      {
+        return false;
+      }
+
+      if (size == 0)
+      {
+        std::vector<unsigned char> block(journal_block_size, 0);
+        Journal_Header header{ journal_magic, journal_version, static_cast<std::uint32_t>(sizeof(T)),
+          static_cast<std::uint32_t>(record_size), static_cast<std::uint32_t>(journal_block_size) };
+
+        std::memcpy(block.data(), &header, sizeof(header));
+        this->sequence = 0;
+        *end = journal_block_size;
+
+        return this->file.write_at(block.data(), block.size(), 0) && this->file.sync();
+      }
+
+      Journal_Header header{};
+
+      if (size < journal_block_size || this->file.read_at(&header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != journal_magic || header.version != journal_version || header.item_size != sizeof(T) ||
+        header.record_size != record_size || header.header_size != journal_block_size)
+      {
+        return false; // Not a journal of T; leave it alone
+      }
+
+      std::uint64_t records = (size - journal_block_size) / record_size;
+      std::vector<unsigned char> record(record_size);
+
+      // A crash can leave the last records partially written
+      while (records != 0)
+      {
+        std::uint64_t offset = journal_block_size + (records - 1) * record_size;
+
+        if (this->file.read_at(record.data(), record_size, offset) == record_size &&
+          this->record_is_valid(record.data()))
+        {
+          break;
+        }
+
+        --records;
+      }
+
+      Journal_Record last{};
+
+      if (records != 0)
+      {
+        std::memcpy(&last, record.data(), sizeof(last));
+      }
+
+      this->sequence = (records != 0) ? last.sequence + 1 : 0;
+      *end = journal_block_size + records * record_size;
+
+      return (*end == size) || this->file.truncate(*end);
+    }
+
+  public:
+    // Open path for appending, creating it if it does not exist. Returns
+    // false if it cannot be opened or is not a journal of T.
+    bool open(const char* path, Journal_Options journal_options = Journal_Options())
+    {
+      this->close();
+      this->options = journal_options;
+
+      std::uint64_t end = 0;
+
+      if (!this->file.open(path, false) || !this->prepare_file(&end))
+      {
+        this->file.close();
+        return false;
+      }
+
+      if (this->options.direct_io && !this->file.open(path, true))
+      {
+        return false;
+      }
+
+      this->buffer_capacity = (this->options.buffer_size + journal_block_size - 1) & ~(journal_block_size - 1);
+      this->buffer_capacity = (this->buffer_capacity != 0) ? this->buffer_capacity : journal_block_size;
+
+      // Two block-aligned buffers, as direct I/O requires
+      this->memory.assign(2 * this->buffer_capacity + journal_block_size, 0);
+      std::size_t misalignment = reinterpret_cast<std::uintptr_t>(this->memory.data()) & (journal_block_size - 1);
+      this->buffers[0] = this->memory.data() + ((journal_block_size - misalignment) & (journal_block_size - 1));
+      this->buffers[1] = this->buffers[0] + this->buffer_capacity;
+
+      // Start at the block holding the end of the file, with its bytes loaded
+      this->active = 0;
+      this->active_offset = end & ~static_cast<std::uint64_t>(journal_block_size - 1);
+      this->active_length = static_cast<std::size_t>(end - this->active_offset);
+      this->carried = this->active_length;
+
+      if (this->active_length != 0 &&
+        this->file.read_at(this->buffers[0], journal_block_size, this->active_offset) < this->active_length)
+      {
+        this->file.close();
+        return false;
+      }
+
+      if (!this->drain_items)
+      {
+        // Kept across reopening, with any batch a failed write left behind
+        this->drain_items.reset(new T[journal_drain_batch]);
+        this->drain_important.reset(new bool[journal_drain_batch]);
+      }
+
+      this->has_pending = false;
+      this->stopping = false;
+      this->failed = false;
+      this->written_sequence = this->sequence;
+      this->writer = std::thread(&Journal_Writer::writer_loop, this);
+
+      return true;
+    }
+
+    // Write everything appended so far and stop the writer thread
+    void close()
+    {
+      if (!this->writer.joinable())
+      {
+        return;
+      }
+
+      this->submit(true);
+
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+      }
+
+      this->condition.notify_all();
+      this->writer.join();
+      this->file.close();
+    }
+
+    bool is_open() const
+    {
+      return this->writer.joinable();
+    }
+
+    // Append one record. Returns false if the journal is closed or a
+    // previous write failed; the journal is unusable after that.
+    bool append(const T& item, bool important = false)
+    {
+      if (!this->is_open())
+      {
+        return false;
+      }
+
+      Journal_Record header{ this->sequence, important ? static_cast<std::uint32_t>(journal_important) : 0u, 0 };
+      header.checksum = detail::fnv1a(&header.sequence, sizeof(header.sequence));
+      header.checksum = detail::fnv1a(&header.flags, sizeof(header.flags), header.checksum);
+      header.checksum = detail::fnv1a(&item, sizeof(T), header.checksum);
+
+      static const unsigned char padding[8]{};
+
+      if (!this->put(&header, sizeof(header)) || !this->put(&item, sizeof(T)) ||
+        !this->put(padding, record_size - sizeof(Journal_Record) - sizeof(T)))
+      {
+        return false;
+      }
+
+      ++this->sequence;
+      return true;
+    }
+
+    bool append(const T* items, std::size_t count, const bool* important = nullptr)
+    {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        if (!this->append(items[i], (important != nullptr) && important[i]))
+        {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    // Dequeue a batch from source with dequeue_bulk(), journal it and, if
+    // forward is not null, enqueue it there (a mirror: downstream consumers
+    // only see journaled items). Stores the number of items moved in
+    // *moved. Returns false if the journal is closed or a write failed; the
+    // rest of the batch is then kept and moved first by the next drain()
+    // after open(), so no item taken from source is lost. Items forward
+    // refuses are counted in forward_dropped().
+    template <typename Source, typename Target = Source>
+    bool drain(Source& source, Target* forward = nullptr, std::size_t* moved = nullptr)
+    {
+      std::size_t start = this->drain_done;
+
+      if (this->drain_done == this->drain_count && this->is_open())
+      {
+        this->drain_count = source.dequeue_bulk(this->drain_items.get(), journal_drain_batch, this->drain_important.get());
+        this->drain_done = 0;
+        start = 0;
+      }
+
+      bool result = true;
+
+      for (; this->drain_done < this->drain_count; ++this->drain_done)
+      {
+        const T& item = this->drain_items[this->drain_done];
+        bool important = this->drain_important[this->drain_done];
+
+        if (!this->append(item, important))
+        {
+          result = false;
+          break;
+        }
+
+        if (forward != nullptr && !forward->enqueue(item, important))
+        {
+          ++this->forward_drops;
+        }
+      }
+
+      if (moved != nullptr)
+      {
+        *moved = this->drain_done - start;
+      }
+
+      return result && this->is_open();
+    }
+
+    // Items drain() journaled but forward refused (e.g. a full queue whose
+    // oldest slot stayed busy)
+    std::uint64_t forward_dropped() const
+    {
+      return this->forward_drops;
+    }
+
+    // Hand buffered records to the writer thread; with wait, return once
+    // they are written (and synced with sync_data)
+    bool flush(bool wait = true)
+    {
+      return this->is_open() && this->submit(wait);
+    }
+
+    // Number of the next record appended
+    std::uint64_t next_sequence() const
+    {
+      return this->sequence;
+    }
+
+    // Records written to the file so far (synced with sync_data)
+    std::uint64_t written()
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      return this->written_sequence;
+    }
+
+    explicit Journal_Writer(const char* path, Journal_Options journal_options = Journal_Options())
+    {
+      this->open(path, journal_options);
+    }
+
+    // Default constructor
+    Journal_Writer() = default;
+
+    Journal_Writer(const Journal_Writer&) = delete;
+    Journal_Writer& operator=(const Journal_Writer&) = delete;
+
+    ~Journal_Writer()
+    {
+      this->close();
+    }
+  };
+
+  // Reads the records of a journal in order
+  template <typename T>
+  class Journal_Reader
+  {
+  private:
+    static_assert(std::is_trivially_copyable<T>::value, "Journal_Reader requires a trivially copyable T");
+
+    static constexpr std::size_t record_size =
+      (sizeof(Journal_Record) + sizeof(T) + 7) & ~static_cast<std::size_t>(7);
+
+    detail::Journal_File file;
+    std::vector<unsigned char> buffer;
+    std::size_t buffered{ 0 }; // Bytes in buffer
+    std::size_t position{ 0 }; // Read position in buffer
+    std::uint64_t offset{ 0 }; // File offset after buffer
+    bool corrupt{ false };
+
+  public:
+    // Open an existing journal of T
+    bool open(const char* path)
+    {
+      this->file.close();
+      this->corrupt = false;
+
+#if defined(_WIN32)
+      if (GetFileAttributesA(path) == INVALID_FILE_ATTRIBUTES)
+#else
+      if (access(path, F_OK) != 0)
+#endif
+      {
+        return false; // Journal_File::open() would create it
+      }
+
+      Journal_Header header{};
+
+      if (!this->file.open(path, false) || this->file.read_at(&header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != journal_magic || header.version != journal_version || header.item_size != sizeof(T) ||
+        header.record_size != record_size)
+      {
+        this->file.close();
+        return false;
+      }
+
+      this->buffer.resize(record_size * 256);
+      this->buffered = 0;
+      this->position = 0;
+      this->offset = header.header_size;
+
+      return true;
+    }
+
+    // Read the next record. Returns false at the end of the journal or at a
+    // damaged record (see is_corrupt()).
+    bool next(T* item, bool* important = nullptr, std::uint64_t* sequence = nullptr)
+    {
+      if (this->buffered - this->position < record_size)
+      {
+        this->buffered = this->file.read_at(this->buffer.data(), this->buffer.size(), this->offset);
+        this->offset += this->buffered;
+        this->position = 0;
+
+        if (this->buffered < record_size)
+        {
+          return false; // End, or a torn record the writer will cut off
+        }
+      }
+
+      const unsigned char* record = this->buffer.data() + this->position;
+      Journal_Record header;
+      std::memcpy(&header, record, sizeof(header));
+
+      std::uint32_t checksum = detail::fnv1a(&header.sequence, sizeof(header.sequence));
+      checksum = detail::fnv1a(&header.flags, sizeof(header.flags), checksum);
+      checksum = detail::fnv1a(record + sizeof(Journal_Record), sizeof(T), checksum);
+
+      if (checksum != header.checksum)
+      {
+        this->corrupt = true;
+        return false;
+      }
+
+      std::memcpy(item, record + sizeof(Journal_Record), sizeof(T));
+
+      if (important != nullptr)
+      {
+        *important = (header.flags & journal_important) != 0;
+      }
+
+      if (sequence != nullptr)
+      {
+        *sequence = header.sequence;
+      }
+
+      this->position += record_size;
+      return true;
+    }
+
+    // Whether next() stopped at a record whose checksum does not match
+    bool is_corrupt() const
+    {
+      return this->corrupt;
+    }
+
+    void close()
+    {
+      this->file.close();
+    }
+
+    explicit Journal_Reader(const char* path)
+    {
+      this->open(path);
+    }
+
+    // Default constructor
+    Journal_Reader() = default;
+  };
+
+  // Re-enqueue the records of the journal at path, starting at record
+  // from_sequence, into queue. Shared_Queue overwrites its oldest item when
+  // full, so replay into a queue that is being consumed or is large enough.
+  // Returns the number of items enqueued.
+  template <typename T, typename Queue>
+  std::uint64_t replay_journal(const char* path, Queue& queue, std::uint64_t from_sequence = 0)
+  {
+    Journal_Reader<T> reader;
+
+    if (!reader.open(path))
+    {
+      return 0;
+    }
+
+    T item;
+    bool important = false;
+    std::uint64_t sequence = 0;
+    std::uint64_t count = 0;
+
+    while (reader.next(&item, &important, &sequence))
+    {
+      if (sequence >= from_sequence)
+      {
+        queue.enqueue(item, important);
+        ++count;
+      }
+    }
+
+    return count;
+  }
+} // namespace sq
+
+#endif // MPMC_SHARED_JOURNAL_H
@@ -0,0 +1,199 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_MPSC_QUEUE_H
+#define MPMC_SHARED_MPSC_QUEUE_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t, std::ptrdiff_t
+#include <new>         // For placement new
+
+#include "shared_intrinsics.h"
+
+namespace sq
+{
+  // Multi-Producer and Single-Consumer queue. Producers reserve a position
+  // with a CAS on tail and publish it through the slot's sequence number.
+  // The consumer owns head exclusively, so reading never needs an RMW and
+  // a batch of items can be drained with a single store to head.
+  template <typename T, std::size_t Capacity>
+  class Shared_Mpsc_Queue
+  {
+  private:
+    static_assert(Capacity > 1, "Capacity must be greater than one");
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    struct alignas(64) Buffer_Slot
+    {
+      std::atomic<std::size_t> sequence; // Position this slot is ready for
+      T data;
+    };
+
+    struct Shared_Control_Block
+    {
+      std::atomic<std::size_t> head;       // Consumer position
+      char head_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::atomic<std::size_t> tail;       // Producer position
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    Buffer_Slot* buffer{ nullptr };                 // Circular buffer slots
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity;
+    }
+
+    // Slots start on a cache line boundary, like the segment itself
+    constexpr static std::size_t aligned_control_size()
+    {
+      return (sizeof(Shared_Control_Block) + cache_line_size - 1) & ~(cache_line_size - 1);
+    }
+
+  public:
+    constexpr static std::size_t required_size()
+    {
+      return aligned_control_size() + (sizeof(Buffer_Slot) * Capacity);
+    }
+
+    // Check if the buffer is empty
+    bool is_empty() const
+    {
+      return (this->size() == 0);
+    }
+
+    // Count of items in the buffer, including reserved but unpublished ones
+    std::size_t size() const
+    {
+      std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+      std::size_t tail = this->control_block->tail.load(std::memory_order_acquire);
+      return tail - head;
+    }
+
+    // Enqueue a new item. Safe to call from any number of producers.
+    // Returns false if the queue is full.
+    bool enqueue(const T& item)
+    {
+      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
+      Buffer_Slot* slot = nullptr;
+
+      while (true)
+      {
+        slot = &this->buffer[wrap(pos)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - pos);
+
+        if (difference == 0)
+        {
+          // Slot is free for this position; try to reserve it
+          if (this->control_block->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            break;
+          }
+        }
+        else if (difference < 0)
+        {
+          // Consumer has not released this slot yet; queue is full
+          return false;
+        }
+        else
+        {
+          // Another producer took this position
+          pos = this->control_block->tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot->data = item;
+      slot->sequence.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Dequeue an item. Must only be called by the consumer.
+    // Returns false if no published item is available.
+    bool dequeue(T* item)
+    {
+      return (this->dequeue_bulk(item, 1) == 1);
+    }
+
+    // Dequeue up to max_items published items into items.
+    // Must only be called by the consumer. Returns the number of items dequeued.
+    std::size_t dequeue_bulk(T* items, std::size_t max_items)
+    {
+      std::size_t pos = this->control_block->head.load(std::memory_order_relaxed);
+      std::size_t count = 0;
+
+      while (count < max_items)
+      {
+        Buffer_Slot& slot = this->buffer[wrap(pos)];
+
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+        {
+          // Not published yet (or the queue is empty)
+          break;
+        }
+
+        if (SQ_PREFETCH_DISTANCE != 0)
+        {
+          // Producers mostly publish in order, so upcoming slots are likely ready soon
+          detail::prefetch_read(&this->buffer[wrap(pos + SQ_PREFETCH_DISTANCE)], sizeof(Buffer_Slot));
+        }
+
+        items[count++] = slot.data;
+
+        // Hand the slot back to producers for the next lap
+        slot.sequence.store(pos + Capacity, std::memory_order_release);
+        ++pos;
+      }
+
+      if (count != 0)
+      {
+        this->control_block->head.store(pos, std::memory_order_release);
+      }
+
+      return count;
+    }
+
+    // Create queue. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Mpsc_Queue<T, Capacity>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->buffer = reinterpret_cast<Buffer_Slot*>(
+        static_cast<char*>(shared_memory) + aligned_control_size()
+        );
+
+      if (this->control_block->capacity != Capacity)
+      {
+        // Initialize control block and buffer
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->head.store(0, std::memory_order_relaxed);
+        this->control_block->tail.store(0, std::memory_order_relaxed);
+        this->control_block->capacity = Capacity;
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+          new (&this->buffer[i]) Buffer_Slot();
+          this->buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+      }
+
+      return true;
+    }
+
+    explicit Shared_Mpsc_Queue(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Mpsc_Queue() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_MPSC_QUEUE_H
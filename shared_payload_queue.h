@@ -0,0 +1,263 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_PAYLOAD_QUEUE_H
+#define MPMC_SHARED_PAYLOAD_QUEUE_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t, std::ptrdiff_t
+#include <cstdint>     // For std::uint64_t
+#include <new>         // For placement new
+
+#include "shared_block_pool.h"
+
+namespace sq
+{
+  // Location of a payload, relative to the start of the queue's shared memory
+  struct Payload_Handle
+  {
+    std::uint64_t offset{ 0 }; // Offset of the payload block
+    std::uint64_t length{ 0 }; // Bytes used in the block
+  };
+
+  // Multi-Producer and Multi-Consumer queue that moves large payloads
+  // without copying them. Payloads live in a Shared_Block_Pool placed in the
+  // same shared memory, and the ring only carries small Payload_Handles, so
+  // it stays cache resident regardless of payload size.
+  //
+  // Producer:
+  //
+  //   Payload_Handle handle;
+  //   void* frame = queue.allocate(size, &handle);
+  //   fill(frame, size);
+  //   queue.enqueue(handle);
+  //
+  // Consumer:
+  //
+  //   Payload_Handle handle;
+  //   if (queue.dequeue(&handle))
+  //   {
+  //     process(queue.payload(handle), handle.length);
+  //     queue.deallocate(handle);
+  //   }
+  template <std::size_t Capacity, std::size_t Block_Size, std::size_t Block_Count>
+  class Shared_Payload_Queue
+  {
+  private:
+    static_assert(Capacity > 1, "Capacity must be greater than one");
+
+    using Pool = Shared_Block_Pool<Block_Size, Block_Count>;
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    struct Buffer_Slot
+    {
+      std::atomic<std::size_t> sequence;   // Position this slot is ready for
+      Payload_Handle handle;
+    };
+
+    struct Shared_Control_Block
+    {
+      std::atomic<std::size_t> head;       // Consumer position
+      char head_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::atomic<std::size_t> tail;       // Producer position
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    Buffer_Slot* buffer{ nullptr };                 // Circular buffer of handles
+    Pool pool;                                      // Payload blocks
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity;
+    }
+
+    constexpr static std::size_t align_up(std::size_t size, std::size_t alignment)
+    {
+      return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    constexpr static std::size_t aligned_control_size()
+    {
+      return align_up(sizeof(Shared_Control_Block), alignof(std::max_align_t));
+    }
+
+    constexpr static std::size_t pool_offset()
+    {
+      return align_up(aligned_control_size() + (sizeof(Buffer_Slot) * Capacity), cache_line_size);
+    }
+
+  public:
+    constexpr static std::size_t required_size()
+    {
+      return pool_offset() + Pool::required_size();
+    }
+
+    // Check if the buffer is empty
+    bool is_empty() const
+    {
+      return (this->size() == 0);
+    }
+
+    // Count of handles in the buffer, including reserved but unpublished ones
+    std::size_t size() const
+    {
+      std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+      std::size_t tail = this->control_block->tail.load(std::memory_order_acquire);
+      return tail - head;
+    }
+
+    // Number of free payload blocks
+    std::size_t available() const
+    {
+      return this->pool.available();
+    }
+
+    // Allocate a payload block for length bytes and describe it in *handle.
+    // Returns nullptr if length exceeds Block_Size or the pool is exhausted.
+    void* allocate(std::size_t length, Payload_Handle* handle)
+    {
+      if (length > Block_Size)
+      {
+        return nullptr;
+      }
+
+      std::uint32_t index = this->pool.allocate();
+
+      if (index == Pool::invalid_block)
+      {
+        return nullptr;
+      }
+
+      handle->offset = pool_offset() + Pool::offset_of(index);
+      handle->length = length;
+
+      return this->pool.block(index);
+    }
+
+    // Return a payload block to the pool once the consumer is done with it
+    void deallocate(const Payload_Handle& handle)
+    {
+      this->pool.deallocate(Pool::index_of(static_cast<std::size_t>(handle.offset) - pool_offset()));
+    }
+
+    // Address of a payload in this process
+    void* payload(const Payload_Handle& handle) const
+    {
+      return reinterpret_cast<char*>(this->control_block) + handle.offset;
+    }
+
+    // Enqueue a handle. Returns false if the queue is full; the payload
+    // block then still belongs to the caller.
+    bool enqueue(const Payload_Handle& handle)
+    {
+      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
+      Buffer_Slot* slot = nullptr;
+
+      while (true)
+      {
+        slot = &this->buffer[wrap(pos)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - pos);
+
+        if (difference == 0)
+        {
+          if (this->control_block->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            break;
+          }
+        }
+        else if (difference < 0)
+        {
+          return false;
+        }
+        else
+        {
+          pos = this->control_block->tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      slot->handle = handle;
+      slot->sequence.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Dequeue a handle. The caller owns the payload block afterwards and
+    // must hand it back with deallocate(). Returns false if the queue is empty.
+    bool dequeue(Payload_Handle* handle)
+    {
+      std::size_t pos = this->control_block->head.load(std::memory_order_relaxed);
+      Buffer_Slot* slot = nullptr;
+
+      while (true)
+      {
+        slot = &this->buffer[wrap(pos)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+
+        if (difference == 0)
+        {
+          if (this->control_block->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            break;
+          }
+        }
+        else if (difference < 0)
+        {
+          return false;
+        }
+        else
+        {
+          pos = this->control_block->head.load(std::memory_order_relaxed);
+        }
+      }
+
+      *handle = slot->handle;
+      slot->sequence.store(pos + Capacity, std::memory_order_release);
+
+      return true;
+    }
+
+    // Create queue. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Payload_Queue<Capacity, Block_Size, Block_Count>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->buffer = reinterpret_cast<Buffer_Slot*>(
+        static_cast<char*>(shared_memory) + aligned_control_size()
+        );
+
+      if (this->control_block->capacity != Capacity)
+      {
+        // Initialize control block and buffer
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->head.store(0, std::memory_order_relaxed);
+        this->control_block->tail.store(0, std::memory_order_relaxed);
+        this->control_block->capacity = Capacity;
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+          new (&this->buffer[i]) Buffer_Slot();
+          this->buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+      }
+
+      return this->pool.create(static_cast<char*>(shared_memory) + pool_offset());
+    }
+
+    explicit Shared_Payload_Queue(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Payload_Queue() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_PAYLOAD_QUEUE_H
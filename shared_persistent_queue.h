@@ -0,0 +1,402 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_PERSISTENT_QUEUE_H
+#define MPMC_SHARED_PERSISTENT_QUEUE_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint32_t, std::uint64_t
+#include <cstring>     // For std::memset
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN // Keep winsock, RPC and the like out of the including code
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX            // Keep min/max macros from breaking std::min and std::max
+#endif
+#include <windows.h>
+#else
+#include <cerrno>      // For errno, EINTR
+#include <fcntl.h>     // For open
+#include <sys/file.h>  // For flock
+#include <sys/mman.h>  // For mmap, msync
+#include <sys/stat.h>  // For fstat
+#include <unistd.h>    // For ftruncate, close
+#endif
+
+#include "shared_queue.h"
+
+namespace sq
+{
+  // How the mapping is flushed to the file
+  enum Sync_Mode
+  {
+    sync_none,     // Only when sync() is called; the kernel writes back dirty pages whenever it likes
+    sync_async,    // Start write-back every sync_every operations (msync MS_ASYNC)
+    sync_blocking  // Wait for write-back every sync_every operations (msync MS_SYNC)
+  };
+
+  struct Persistence_Options
+  {
+    Sync_Mode mode{ sync_none };
+    std::uint32_t sync_every{ 0 }; // Group commit: operations per flush, counted per handle; 0 disables
+  };
+
+  // Shared_Queue placed in a memory-mapped file, so queued items survive a
+  // crash of every process using it (the page cache keeps the mapping) and,
+  // once flushed, a reboot. Processes that open the same file share the
+  // queue like any other segment.
+  //
+  // open() initializes a new, empty file. An existing file is attached
+  // only if it holds a queue with exactly this layout; anything else is
+  // refused rather than wiped or resized. Pass recover = true when no other
+  // process can be using the file (e.g. the first process after a crash or
+  // boot) to drop partially written items (see Shared_Queue::recover()) and
+  // to initialize a file whose first open() crashed before it finished.
+  //
+  // Items published after the last completed flush can be lost, or torn
+  // across pages, by a power failure; use sync_blocking or sync() where
+  // that matters.
+  template <typename T, std::size_t Capacity, std::uint32_t Features = feature_none>
+  class Persistent_Queue
+  {
+  private:
+    using Queue = Shared_Queue<T, Capacity, Features>;
+
+    Queue shared_queue;
+    Persistence_Options options;
+    void* mapping{ nullptr };
+    std::size_t recovered_discards{ 0 }; // Positions dropped by the last open()
+    std::uint32_t pending{ 0 };          // Operations since the last group commit
+
+#if defined(_WIN32)
+    HANDLE file{ INVALID_HANDLE_VALUE };
+    HANDLE file_mapping{ NULL };
+#else
+    int file{ -1 };
+#endif
+
+    // Open path, take the initialization lock (see open()) and map it. A
+    // new, empty file is grown to required_size() and sets is_new. An
+    // existing file is never resized: one smaller than required_size()
+    // cannot hold this queue and is refused untouched.
+    bool map_file(const char* path, bool* is_new)
+    {
+#if defined(_WIN32)
+      this->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+      if (this->file == INVALID_HANDLE_VALUE)
+      {
+        return false;
+      }
+
+      OVERLAPPED lock_range = {};
+      lock_range.Offset = 0xFFFFFFFF;
+      lock_range.OffsetHigh = 0x7FFFFFFF; // Far past the data, so the lock never covers mapped bytes
+
+      if (!LockFileEx(this->file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &lock_range))
+      {
+        return false;
+      }
+
+      LARGE_INTEGER size;
+
+      if (!GetFileSizeEx(this->file, &size))
+      {
+        return false;
+      }
+
+      *is_new = (size.QuadPart == 0);
+
+      if (!*is_new && static_cast<std::uint64_t>(size.QuadPart) < Queue::required_size())
+      {
+        return false;
+      }
+
+      // CreateFileMapping grows the file to the mapping size, which only
+      // changes a new file
+      std::uint64_t mapping_size = Queue::required_size();
+      this->file_mapping = CreateFileMappingA(this->file, NULL, PAGE_READWRITE,
+        static_cast<DWORD>(mapping_size >> 32), static_cast<DWORD>(mapping_size & 0xFFFFFFFF), NULL);
+
+      if (this->file_mapping == NULL)
+      {
+        return false;
+      }
+
+      this->mapping = MapViewOfFile(this->file_mapping, FILE_MAP_ALL_ACCESS, 0, 0, Queue::required_size());
+      return (this->mapping != NULL);
+#else
+      this->file = ::open(path, O_RDWR | O_CREAT, 0600);
+
+      if (this->file == -1)
+      {
+        return false;
+      }
+
+      while (flock(this->file, LOCK_EX) != 0)
+      {
+        if (errno != EINTR)
+        {
+          return false;
+        }
+      }
+
+      struct stat status;
+
+      if (fstat(this->file, &status) != 0)
+      {
+        return false;
+      }
+
+      *is_new = (status.st_size == 0);
+
+      if (!*is_new && static_cast<std::uint64_t>(status.st_size) < Queue::required_size())
+      {
+        return false;
+      }
+
+      if (*is_new && ftruncate(this->file, static_cast<off_t>(Queue::required_size())) != 0)
+      {
+        return false;
+      }
+
+      void* view = mmap(nullptr, Queue::required_size(), PROT_READ | PROT_WRITE, MAP_SHARED, this->file, 0);
+
+      if (view == MAP_FAILED)
+      {
+        return false;
+      }
+
+      this->mapping = view;
+      return true;
+#endif
+    }
+
+    // Release the lock taken by map_file()
+    void unlock_file()
+    {
+#if defined(_WIN32)
+      if (this->file != INVALID_HANDLE_VALUE)
+      {
+        OVERLAPPED lock_range = {};
+        lock_range.Offset = 0xFFFFFFFF;
+        lock_range.OffsetHigh = 0x7FFFFFFF;
+        UnlockFileEx(this->file, 0, 1, 0, &lock_range);
+      }
+#else
+      if (this->file != -1)
+      {
+        flock(this->file, LOCK_UN);
+      }
+#endif
+    }
+
+    // Count an operation and flush if a group commit is due
+    void commit_operation()
+    {
+      if (this->options.mode != sync_none && this->options.sync_every != 0 &&
+        ++this->pending >= this->options.sync_every)
+      {
+        this->sync(this->options.mode == sync_blocking);
+      }
+    }
+
+  public:
+    // Open (or create) the queue file at path. Returns false if the file
+    // cannot be mapped or holds something other than this queue, or if
+    // the queue has feature_owners and its owner table is full. An exclusive
+    // file lock is held until the queue is initialized or attached, so two
+    // processes creating the same file do not both initialize it.
+    bool open(const char* path, bool recover = false, Persistence_Options persistence = Persistence_Options())
+    {
+      this->close();
+      this->options = persistence;
+
+      bool is_new = false;
+
+      if (!this->map_file(path, &is_new))
+      {
+        this->close();
+        return false;
+      }
+
+      if (!is_new && static_cast<const Queue_Layout*>(this->mapping)->magic == 0)
+      {
+        // Grown but without a layout: the first open() crashed before its
+        // create() finished (a running one would still hold the lock), or
+        // the file is not a queue. Only recovery may start it over.
+        if (!recover)
+        {
+          this->close();
+          return false;
+        }
+
+        std::memset(this->mapping, 0, Queue::required_size());
+        is_new = true;
+      }
+
+      if (!is_new && !Queue::matches_layout(this->mapping))
+      {
+        this->close();
+        return false;
+      }
+
+      // A new file reads as zeros, so create() initializes it. With
+      // feature_owners, a table full of crashed owners only frees up in
+      // recover(), so registration is retried after it.
+      bool registered = this->shared_queue.create(this->mapping);
+      this->recovered_discards = recover ? this->shared_queue.recover() : 0;
+
+      if (!registered && !(recover && this->shared_queue.create(this->mapping)))
+      {
+        this->close();
+        return false;
+      }
+
+      if (is_new || this->recovered_discards != 0)
+      {
+        this->sync(true);
+      }
+
+      this->unlock_file();
+      return true;
+    }
+
+    // Flush the mapping to the file; blocking waits until it is written
+    bool sync(bool blocking = true)
+    {
+      if (this->mapping == nullptr)
+      {
+        return false;
+      }
+
+      this->pending = 0;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+#if defined(_WIN32)
+      if (!FlushViewOfFile(this->mapping, 0))
+      {
+        return false;
+      }
+
+      return !blocking || FlushFileBuffers(this->file);
+#else
+      return (msync(this->mapping, Queue::required_size(), blocking ? MS_SYNC : MS_ASYNC) == 0);
+#endif
+    }
+
+    // Flush and unmap. Safe to call more than once.
+    void close()
+    {
+      if (this->mapping != nullptr)
+      {
+        this->sync(true);
+      }
+
+      this->unlock_file();
+
+#if defined(_WIN32)
+      if (this->mapping != nullptr)
+      {
+        UnmapViewOfFile(this->mapping);
+      }
+
+      if (this->file_mapping != NULL)
+      {
+        CloseHandle(this->file_mapping);
+        this->file_mapping = NULL;
+      }
+
+      if (this->file != INVALID_HANDLE_VALUE)
+      {
+        CloseHandle(this->file);
+        this->file = INVALID_HANDLE_VALUE;
+      }
+#else
+      if (this->mapping != nullptr)
+      {
+        munmap(this->mapping, Queue::required_size());
+      }
+
+      if (this->file != -1)
+      {
+        ::close(this->file);
+        this->file = -1;
+      }
+#endif
+
+      this->mapping = nullptr;
+      this->pending = 0;
+    }
+
+    bool is_open() const
+    {
+      return (this->mapping != nullptr);
+    }
+
+    // Positions dropped by recovery in the last open()
+    std::size_t discarded_on_recovery() const
+    {
+      return this->recovered_discards;
+    }
+
+    // The underlying queue, for operations without group commit accounting
+    Queue& queue()
+    {
+      return this->shared_queue;
+    }
+
+    bool enqueue(const T& item, bool important = false)
+    {
+      bool result = this->shared_queue.enqueue(item, important);
+      this->commit_operation();
+      return result;
+    }
+
+    bool dequeue(T* item, bool* important = nullptr)
+    {
+      if (!this->shared_queue.dequeue(item, important))
+      {
+        return false;
+      }
+
+      this->commit_operation();
+      return true;
+    }
+
+    std::size_t size() const
+    {
+      return this->shared_queue.size();
+    }
+
+    bool is_empty() const
+    {
+      return this->shared_queue.is_empty();
+    }
+
+    explicit Persistent_Queue(const char* path, bool recover = false,
+      Persistence_Options persistence = Persistence_Options())
+    {
+      this->open(path, recover, persistence);
+    }
+
+    // Default constructor
+    Persistent_Queue() = default;
+
+    Persistent_Queue(const Persistent_Queue&) = delete;
+    Persistent_Queue& operator=(const Persistent_Queue&) = delete;
+
+    ~Persistent_Queue()
+    {
+      this->close();
+    }
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_PERSISTENT_QUEUE_H
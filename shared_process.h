@@ -0,0 +1,62 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_PROCESS_H
+#define MPMC_SHARED_PROCESS_H
+
+#include <cstdint>     // For std::uint64_t
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN // Keep winsock, RPC and the like out of the including code
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX            // Keep min/max macros from breaking std::min and std::max
+#endif
+#include <windows.h>
+#else
+#include <cerrno>      // For errno, ESRCH
+#include <signal.h>    // For kill
+#include <unistd.h>    // For getpid
+#endif
+
+// Process identity helpers for queues that track which process owns what
+namespace sq
+{
+  namespace detail
+  {
+    inline std::uint64_t current_process_id()
+    {
+#if defined(_WIN32)
+      return static_cast<std::uint64_t>(GetCurrentProcessId());
+#else
+      return static_cast<std::uint64_t>(getpid());
+#endif
+    }
+
+    // Whether the process still exists. A recycled PID reads as alive, which
+    // errs on the side of leaving its resources alone.
+    inline bool process_is_alive(std::uint64_t pid)
+    {
+#if defined(_WIN32)
+      HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+
+      if (process == NULL)
+      {
+        // Access denied means it exists but belongs to someone else
+        return (GetLastError() == ERROR_ACCESS_DENIED);
+      }
+
+      bool alive = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+      CloseHandle(process);
+      return alive;
+#else
+      return (kill(static_cast<pid_t>(pid), 0) == 0) || (errno != ESRCH);
+#endif
+    }
+  } // namespace detail
+} // namespace sq
+
+#endif // MPMC_SHARED_PROCESS_H
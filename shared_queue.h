@@ -7,165 +7,1832 @@
 #define MPMC_SHARED_QUEUE_H
 
 #include <atomic>      // For std::atomic
-#include <cstddef>     // For std::size_t
+#include <cstddef>     // For std::size_t, std::ptrdiff_t
+#include <cstdint>     // For std::uint32_t, std::uint64_t
+#include <cstring>     // For std::memcpy
 //#include <stdexcept> // For std::runtime_error
 #include <new>         // For placement new
 #include <memory>      // Optional, if smart pointers are used
+#include <thread>      // For std::this_thread::yield
+#include <type_traits> // For std::is_trivially_copyable, std::is_standard_layout
 //#include <iostream>  // For debug output (optional, can be removed)
 
+#include "shared_intrinsics.h"
+#include "shared_process.h"
+#include "shared_trace.h"
+
+// Smallest T that enqueue_streaming() writes with non-temporal stores
+#ifndef SQ_STREAMING_THRESHOLD
+#define SQ_STREAMING_THRESHOLD 1024
+#endif
+
+// Number of counter shards in the statistics area (see feature_stats)
+#ifndef SQ_STATS_SHARDS
+#define SQ_STATS_SHARDS 16
+#endif
+
+// One in this many enqueues carries a timestamp (see feature_latency); a power of two
+#ifndef SQ_LATENCY_SAMPLE_RATE
+#define SQ_LATENCY_SAMPLE_RATE 64
+#endif
+
+// Spins on a slot that another thread is still writing or reading before
+// yielding the CPU to it
+#ifndef SQ_SPIN_LIMIT
+#define SQ_SPIN_LIMIT 128
+#endif
+
+// Waits a full enqueue makes for the oldest slot while another thread is
+// still writing or reading it, before enqueue() gives up and returns false
+#ifndef SQ_FULL_WAIT_LIMIT
+#define SQ_FULL_WAIT_LIMIT (SQ_SPIN_LIMIT * 64)
+#endif
+
+// Number of handles that can be registered at once (see feature_owners)
+#ifndef SQ_OWNER_SLOTS
+#define SQ_OWNER_SLOTS 64
+#endif
+
+// Nanoseconds between the scans for expired leases a handle makes from
+// lease() (see feature_leases)
+#ifndef SQ_LEASE_SCAN_NS
+#define SQ_LEASE_SCAN_NS 1000000
+#endif
+
 namespace sq
 {
-  template <typename T, std::size_t Capacity>
+  // Whether T can be handed between processes through shared memory.
+  // Defaults to trivially copyable, standard-layout types. Types that own
+  // process-local resources (std::string, std::vector, raw pointers to heap
+  // memory, ...) break as soon as another process reads them.
+  //
+  // Specialize it for types that are safe to copy across processes but not
+  // trivially copyable, e.g. types holding sq::offset_ptr members:
+  //
+  //   template <> struct sq::is_shareable<My_Type> : std::true_type {};
+  template <typename T>
+  struct is_shareable : std::integral_constant<bool,
+    std::is_trivially_copyable<T>::value && std::is_standard_layout<T>::value>
+  {
+  };
+
+  // Optional parts of a Shared_Queue segment, combined as a bitmask in the
+  // Features template argument. Every process attaching to a segment must
+  // use the same features, since they change its layout.
+  enum Queue_Feature : std::uint32_t
+  {
+    feature_none = 0,
+    feature_stats = 1u << 0,      // Sharded counters after the buffer; see Shared_Queue::stats()
+    feature_latency = 1u << 1,    // Timestamped slots and a delay histogram; see Shared_Queue::latency()
+    feature_contention = 1u << 2, // Retry counters in the stats shards; requires feature_stats
+    feature_owners = 1u << 3,     // Per-handle owner registration; see Shared_Queue::recover_abandoned()
+    feature_leases = 1u << 4,     // Lease and acknowledge items; see Shared_Queue::lease()
+    feature_ttl = 1u << 5         // Per-item expiry; see Shared_Queue::enqueue_with_ttl()
+  };
+
+  // An item taken with Shared_Queue::lease(), to be passed to ack()
+  struct Queue_Lease
+  {
+    std::size_t position{ 0 };
+  };
+
+  // Snapshot of the counters of a queue, summed over all shards
+  struct Queue_Stats
+  {
+    std::uint64_t enqueued{ 0 };            // Items enqueued
+    std::uint64_t dequeued{ 0 };            // Items dequeued
+    std::uint64_t evicted_important{ 0 };   // Important items overwritten by a full enqueue
+    std::uint64_t evicted_unimportant{ 0 }; // Unimportant items overwritten by a full enqueue
+    std::uint64_t full_hits{ 0 };           // Enqueues that found the queue full
+    std::uint64_t empty_polls{ 0 };         // Dequeue calls that found the queue empty
+    std::uint64_t high_water{ 0 };          // Highest item count seen after an enqueue
+    std::uint64_t expired{ 0 };             // Items dropped at dequeue or overflow because their TTL passed
+  };
+
+  // Retries of one kind of operation, summed over all shards
+  struct Contention_Counters
+  {
+    std::uint64_t cas_failures{ 0 }; // Lost races for a position (failed CAS or stale position)
+    std::uint64_t spins{ 0 };        // Waits for a slot another thread was still writing or reading
+    std::uint64_t parks{ 0 };        // Times a wait yielded the CPU (every SQ_SPIN_LIMIT spins)
+  };
+
+  struct Contention_Snapshot
+  {
+    Contention_Counters enqueue;     // enqueue(), enqueue_streaming(), including evictions
+    Contention_Counters dequeue;     // dequeue(), dequeue_bulk()
+  };
+
+  // Log-linear histogram. Values below 2 << Sub_Bucket_Bits get a bucket each;
+  // above that every power of two is split into 1 << Sub_Bucket_Bits buckets,
+  // so a bucket's bounds are within 2^-Sub_Bucket_Bits of each other.
+  template <unsigned Sub_Bucket_Bits>
+  struct Basic_Latency_Histogram
+  {
+    static constexpr unsigned sub_bucket_bits = Sub_Bucket_Bits;
+    static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) << sub_bucket_bits;
+
+    std::uint64_t counts[bucket_count] = {};
+
+    static std::size_t bucket_of(std::uint64_t value)
+    {
+      if (value < (std::uint64_t(2) << sub_bucket_bits))
+      {
+        return static_cast<std::size_t>(value);
+      }
+
+      unsigned shift = detail::highest_bit(value) - sub_bucket_bits;
+      return static_cast<std::size_t>((std::uint64_t(shift) << sub_bucket_bits) + (value >> shift));
+    }
+
+    // Largest value that falls into bucket
+    static std::uint64_t highest_value(std::size_t bucket)
+    {
+      if (bucket < (std::size_t(2) << sub_bucket_bits))
+      {
+        return bucket;
+      }
+
+      unsigned shift = static_cast<unsigned>(bucket >> sub_bucket_bits) - 1;
+      std::uint64_t mantissa = (bucket & ((std::size_t(1) << sub_bucket_bits) - 1)) | (std::uint64_t(1) << sub_bucket_bits);
+
+      return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::uint64_t total() const
+    {
+      std::uint64_t sum = 0;
+
+      for (std::uint64_t count : this->counts)
+      {
+        sum += count;
+      }
+
+      return sum;
+    }
+
+    // Upper bound of the delay that percent of the samples do not exceed;
+    // 0 when there are no samples
+    std::uint64_t percentile(double percent) const
+    {
+      std::uint64_t wanted = static_cast<std::uint64_t>((percent / 100.0) * static_cast<double>(this->total()) + 0.5);
+      std::uint64_t seen = 0;
+
+      wanted = (wanted == 0) ? 1 : wanted;
+
+      for (std::size_t i = 0; i < bucket_count; ++i)
+      {
+        seen += this->counts[i];
+
+        if (seen >= wanted)
+        {
+          return highest_value(i);
+        }
+      }
+
+      return 0;
+    }
+  };
+
+  // Histogram of enqueue-to-dequeue delays, with buckets within 12.5% of
+  // each other. Units are those of detail::read_clock(): nanoseconds, or
+  // TSC ticks with SQ_LATENCY_USE_TSC.
+  using Latency_Histogram = Basic_Latency_Histogram<3>;
+
+  constexpr std::uint32_t queue_layout_magic = 0x55515153;  // "SQQU" in little endian
+  constexpr std::uint32_t queue_layout_version = 5;
+
+  // Self-description written at the start of every Shared_Queue segment, so
+  // tools that do not know T or Capacity (see tools/sq_inspect.cpp) can
+  // find and validate everything else. Offsets are in bytes from the start
+  // of the segment unless noted otherwise.
+  struct Queue_Layout
+  {
+    std::uint32_t magic;              // queue_layout_magic once initialized
+    std::uint32_t version;            // queue_layout_version
+    std::uint32_t features;           // Queue_Feature bitmask
+    std::uint32_t index_size;         // sizeof(std::size_t) of positions and sequences
+    std::uint64_t capacity;           // Number of slots
+    std::uint64_t item_size;          // sizeof(T)
+    std::uint64_t slot_size;          // Distance between slots
+    std::uint64_t head_offset;        // Free-running consumer position
+    std::uint64_t tail_offset;        // Free-running producer position
+    std::uint64_t buffer_offset;      // First slot
+    std::uint64_t sequence_offset;    // Slot sequence within a slot: position + 1 once published
+    std::uint64_t item_offset;        // Item within a slot
+    std::uint64_t important_offset;   // Importance flag (one byte) within a slot
+    std::uint64_t high_water_offset;  // 0 without feature_stats
+    std::uint64_t shards_offset;      // First stats shard; 0 without feature_stats
+    std::uint64_t shard_size;         // Distance between shards; Queue_Stats, Contention_Snapshot, then expired
+    std::uint64_t shard_count;
+    std::uint64_t total_size;         // required_size()
+    std::uint64_t histogram_offset;   // Latency_Histogram buckets; 0 without feature_latency
+    std::uint32_t histogram_buckets;  // Latency_Histogram::bucket_count
+    std::uint32_t histogram_unit;     // 0 for nanoseconds, 1 for TSC ticks
+    std::uint64_t owners_offset;      // First owner entry; 0 without feature_owners
+    std::uint32_t owner_size;         // Distance between owner entries: pid, producing, consuming, consuming count
+    std::uint32_t owner_count;        // SQ_OWNER_SLOTS
+    std::uint64_t lease_offset;       // Lease position + 1 within a slot, deadline (ns) after it; 0 without feature_leases
+    std::uint64_t expiry_offset;      // Expiry time (ns, 0 for none) within a slot; 0 without feature_ttl
+  };
+
+
+  // Multi-Producer and Multi-Consumer queue. Producers and consumers reserve
+  // a position with a CAS on tail or head and hand the slot over through its
+  // sequence number, so an item is only read once it is fully written. When
+  // the queue is full, enqueue() claims the oldest item like a consumer
+  // would, discards it and takes its slot.
+  template <typename T, std::size_t Capacity, std::uint32_t Features = feature_none>
   class Shared_Queue
   {
   private:
-    struct alignas(64) Buffer_Slot
+    static_assert(is_shareable<T>::value,
+      "T is not safe to share between processes; see sq::is_shareable");
+    static_assert(Capacity > 1, "Capacity must be greater than one");
+
+    static constexpr std::size_t cache_line_size = 64;
+    static constexpr bool stats_enabled = (Features & feature_stats) != 0;
+    static constexpr bool latency_enabled = (Features & feature_latency) != 0;
+    static constexpr bool contention_enabled = (Features & feature_contention) != 0;
+    static constexpr bool owners_enabled = (Features & feature_owners) != 0;
+    static constexpr bool leases_enabled = (Features & feature_leases) != 0;
+    static constexpr bool ttl_enabled = (Features & feature_ttl) != 0;
+
+    static_assert(!contention_enabled || stats_enabled, "feature_contention requires feature_stats");
+    static_assert((SQ_LATENCY_SAMPLE_RATE & (SQ_LATENCY_SAMPLE_RATE - 1)) == 0,
+      "SQ_LATENCY_SAMPLE_RATE must be a power of two");
+
+    // Publish time of the item in a slot, 0 if it was not sampled. Takes no
+    // space unless feature_latency is enabled.
+    template <bool Enabled, typename Unused = void>
+    struct Slot_Timestamp
+    {
+      std::uint64_t published_at{ 0 };
+
+      void set_published(std::uint64_t time) { this->published_at = time; }
+      std::uint64_t published() const { return this->published_at; }
+    };
+
+    template <typename Unused>
+    struct Slot_Timestamp<false, Unused>
+    {
+      void set_published(std::uint64_t) {}
+      std::uint64_t published() const { return 0; }
+    };
+
+    // Lease on the item in a slot. The item of position p is leased while
+    // position == p + 1 and the slot's sequence is p + 1; ack() or
+    // redelivery clears position. Takes no space unless feature_leases is
+    // enabled.
+    template <bool Enabled, typename Unused = void>
+    struct Slot_Lease
+    {
+      std::atomic<std::size_t> lease_position{ 0 };
+      std::atomic<std::uint64_t> lease_deadline{ 0 };
+    };
+
+    template <typename Unused>
+    struct Slot_Lease<false, Unused>
+    {
+    };
+
+    // Time after which the item in a slot is dropped instead of dequeued,
+    // in detail::steady_ns() nanoseconds; 0 if it never expires. Takes no
+    // space unless feature_ttl is enabled.
+    template <bool Enabled, typename Unused = void>
+    struct Slot_Expiry
+    {
+      std::uint64_t expires_at{ 0 };
+
+      void set_expiry(std::uint64_t time) { this->expires_at = time; }
+      std::uint64_t expiry() const { return this->expires_at; }
+    };
+
+    template <typename Unused>
+    struct Slot_Expiry<false, Unused>
     {
+      void set_expiry(std::uint64_t) {}
+      std::uint64_t expiry() const { return 0; }
+    };
+
+    // A slot is free for position p when sequence == p, holds the published
+    // item of p when sequence == p + 1, and is handed to the next lap by
+    // setting sequence to p + Capacity once the item is read or discarded.
+    struct alignas(64) Buffer_Slot : Slot_Timestamp<latency_enabled>, Slot_Lease<leases_enabled>, Slot_Expiry<ttl_enabled>
+    {
+      std::atomic<std::size_t> sequence;
       T data;
       std::atomic<bool> is_important;
-      Buffer_Slot() : is_important(false) {}
+      Buffer_Slot() : sequence(0), is_important(false) {}
+    };
+
+    struct Shared_Control_Block
+    {
+      Queue_Layout layout{};               // Must stay first; see Queue_Layout
+      std::atomic<std::size_t> head;       // Consumer position
+      char head_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::atomic<std::size_t> tail;       // Producer position
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer
+    };
+
+    struct Contention_Shard
+    {
+      std::atomic<std::uint64_t> cas_failures;
+      std::atomic<std::uint64_t> spins;
+      std::atomic<std::uint64_t> parks;
+    };
+
+    // Counters of one shard, on a cache line of their own. Each attached
+    // handle is assigned a shard, so handles used by different threads or
+    // processes increment private lines. Tools rely on the order of the
+    // counters, which matches Queue_Stats, then Contention_Snapshot, then
+    // expired (added after the others to keep their offsets).
+    struct alignas(64) Stats_Shard
+    {
+      std::atomic<std::uint64_t> enqueued;
+      std::atomic<std::uint64_t> dequeued;
+      std::atomic<std::uint64_t> evicted_important;
+      std::atomic<std::uint64_t> evicted_unimportant;
+      std::atomic<std::uint64_t> full_hits;
+      std::atomic<std::uint64_t> empty_polls;
+      Contention_Shard enqueue_contention;
+      Contention_Shard dequeue_contention;
+      std::atomic<std::uint64_t> expired;
+    };
+
+    struct alignas(64) Shared_Stats_Block
+    {
+      std::atomic<std::uint64_t> next_shard;  // Shards handed out so far
+      std::atomic<std::uint64_t> high_water;  // Only written when it grows
+      Stats_Shard shards[SQ_STATS_SHARDS];
+    };
+
+    struct alignas(64) Shared_Latency_Block
+    {
+      std::atomic<std::uint64_t> counts[Latency_Histogram::bucket_count];
+    };
+
+    // Registration of one handle. Before each CAS on tail or head the handle
+    // notes the position(s) it is trying to take, so if its process dies
+    // mid-operation, recover_abandoned() knows which slots it left behind.
+    // There is one note per handle, so each thread needs its own handle.
+    struct alignas(64) Owner_Entry
+    {
+      std::atomic<std::uint64_t> pid;           // 0 when free
+      std::atomic<std::size_t> producing;       // Position + 1 of the last tail reservation attempt, 0 if none
+      std::atomic<std::size_t> consuming;       // Position + 1 of the first item of the last head claim attempt
+      std::atomic<std::size_t> consuming_count; // Items in that claim
+    };
+
+    struct alignas(64) Shared_Owner_Block
+    {
+      Owner_Entry entries[SQ_OWNER_SLOTS];
+    };
+
+    // The owner entry held by a handle. Copies register an entry of their
+    // own, and destroying the handle frees it. Empty unless feature_owners
+    // is enabled.
+    template <bool Enabled, typename Unused = void>
+    struct Owner_Registration
+    {
+      Shared_Owner_Block* block{ nullptr };
+      Owner_Entry* entry{ nullptr };
+
+      // Take a free entry. Returns false if all are taken; the handle then
+      // refuses to operate (see Shared_Queue::is_operational()).
+      bool attach(Shared_Owner_Block* owners)
+      {
+        this->release();
+        this->block = owners;
+
+        for (Owner_Entry& candidate : owners->entries)
+        {
+          std::uint64_t expected = 0;
+
+          if (candidate.pid.load(std::memory_order_relaxed) == 0 &&
+            candidate.pid.compare_exchange_strong(expected, detail::current_process_id(), std::memory_order_acq_rel))
+          {
+            candidate.producing.store(0, std::memory_order_relaxed);
+            candidate.consuming.store(0, std::memory_order_relaxed);
+            candidate.consuming_count.store(0, std::memory_order_relaxed);
+            this->entry = &candidate;
+            return true;
+          }
+        }
+
+        return false;
+      }
+
+      Owner_Entry* registered() const
+      {
+        return this->entry;
+      }
+
+      void release()
+      {
+        if (this->entry != nullptr)
+        {
+          this->entry->pid.store(0, std::memory_order_release);
+          this->entry = nullptr;
+        }
+      }
+
+      void note_producing(std::size_t pos)
+      {
+        if (this->entry != nullptr)
+        {
+          this->entry->producing.store(pos + 1, std::memory_order_relaxed);
+        }
+      }
+
+      void note_consuming(std::size_t pos, std::size_t count)
+      {
+        if (this->entry != nullptr)
+        {
+          this->entry->consuming.store(pos + 1, std::memory_order_relaxed);
+          this->entry->consuming_count.store(count, std::memory_order_relaxed);
+        }
+      }
+
+      Owner_Registration() = default;
+
+      Owner_Registration(const Owner_Registration& other)
+      {
+        if (other.block != nullptr)
+        {
+          this->attach(other.block);
+        }
+      }
+
+      Owner_Registration& operator=(const Owner_Registration& other)
+      {
+        if (this != &other)
+        {
+          this->release();
+          this->block = nullptr;
+
+          if (other.block != nullptr)
+          {
+            this->attach(other.block);
+          }
+        }
+
+        return *this;
+      }
+
+      ~Owner_Registration()
+      {
+        this->release();
+      }
+    };
+
+    template <typename Unused>
+    struct Owner_Registration<false, Unused>
+    {
+      bool attach(Shared_Owner_Block*) { return false; }
+      Owner_Entry* registered() const { return nullptr; }
+      void release() {}
+      void note_producing(std::size_t) {}
+      void note_consuming(std::size_t, std::size_t) {}
     };
 
-    struct Shared_Control_Block
-    {
-      std::atomic<std::size_t> head;       // Consumer position
-      std::atomic<std::size_t> tail;       // Producer position
-      std::atomic<std::size_t> count{ 0 }; // Item counter
-      std::size_t capacity{ 0 };           // Capacity of the buffer
-    };
+    // Expired lease redelivery of one handle. Atomic because threads may
+    // share the handle; a copy starts with a scan due.
+    struct Lease_Scan
+    {
+      std::atomic<std::uint64_t> next{ 0 };  // When lease() next looks for expired leases
+      std::atomic<bool> running{ false };    // Inside redeliver_expired(); stops its enqueues from recursing
+
+      Lease_Scan() = default;
+      Lease_Scan(const Lease_Scan&) {}
+
+      Lease_Scan& operator=(const Lease_Scan&)
+      {
+        return *this;
+      }
+
+      // Whether a scan is due at now. Only one of the threads asking gets true.
+      bool is_due(std::uint64_t now)
+      {
+        std::uint64_t due = this->next.load(std::memory_order_relaxed);
+
+        return now >= due &&
+          this->next.compare_exchange_strong(due, now + SQ_LEASE_SCAN_NS, std::memory_order_relaxed);
+      }
+    };
+
+    // Retries of one operation, flushed to the stats shard when it finishes
+    struct Retry_Counts
+    {
+      std::uint64_t cas_failures{ 0 };
+      std::uint64_t spins{ 0 };
+      std::uint64_t parks{ 0 };
+      std::size_t blocked_on{ 0 }; // Position waited for when the first park happened
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    Buffer_Slot* buffer{ nullptr };                 // Circular buffer slots
+    Shared_Stats_Block* stats_block{ nullptr };     // Statistics area, if enabled
+    Stats_Shard* stats_shard{ nullptr };            // This handle's shard
+    Shared_Latency_Block* latency_block{ nullptr }; // Delay histogram, if enabled
+    Shared_Owner_Block* owner_block{ nullptr };     // Owner registrations, if enabled
+    Owner_Registration<owners_enabled> owner;       // This handle's registration
+    Lease_Scan lease_scan;                          // Expired lease redelivery, if enabled
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity; // Use Capacity as the capacity
+    }
+
+    constexpr static std::size_t aligned_control_size()
+    {
+      return (sizeof(Shared_Control_Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    // The optional areas follow the buffer, each on its own cache lines
+    constexpr static std::size_t stats_offset()
+    {
+      return (aligned_control_size() + (sizeof(Buffer_Slot) * Capacity) + 63) & ~std::size_t(63);
+    }
+
+    constexpr static std::size_t latency_offset()
+    {
+      return stats_offset() + (stats_enabled ? sizeof(Shared_Stats_Block) : 0);
+    }
+
+    constexpr static std::size_t owners_offset()
+    {
+      return latency_offset() + (latency_enabled ? sizeof(Shared_Latency_Block) : 0);
+    }
+
+    // With feature_owners the CAS on tail or head publishes the owner note
+    // made before it
+    static constexpr std::memory_order claim_order = owners_enabled ? std::memory_order_release : std::memory_order_relaxed;
+
+    // Wait for another thread to finish with a slot: spin, and every
+    // SQ_SPIN_LIMIT spins yield in case it was preempted mid-operation
+    static void back_off(Retry_Counts& retries)
+    {
+      if (++retries.spins % SQ_SPIN_LIMIT == 0)
+      {
+        ++retries.parks;
+        std::this_thread::yield();
+      }
+    }
+
+    // Timestamp for the item being enqueued: the clock for one in
+    // SQ_LATENCY_SAMPLE_RATE enqueues of the calling thread, 0 otherwise
+    static std::uint64_t sample_publish_time()
+    {
+      static thread_local std::uint32_t enqueues = 0;
+
+      if (!latency_enabled || (enqueues++ & (SQ_LATENCY_SAMPLE_RATE - 1)) != 0)
+      {
+        return 0;
+      }
+
+      return detail::read_clock();
+    }
+
+    // Record the delay of a dequeued item that carried a timestamp
+    void record_delay(std::uint64_t published, std::uint64_t now)
+    {
+      if (latency_enabled && published != 0)
+      {
+        // Unsynchronized TSCs can make now appear earlier than published
+        std::uint64_t delay = (now > published) ? now - published : 0;
+        this->latency_block->counts[Latency_Histogram::bucket_of(delay)].fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    static std::uint64_t offset_between(const void* base, const void* field)
+    {
+      return static_cast<std::uint64_t>(static_cast<const char*>(field) - static_cast<const char*>(base));
+    }
+
+    std::uint64_t lease_field_offset() const
+    {
+      return lease_field_offset(std::integral_constant<bool, leases_enabled>());
+    }
+
+    std::uint64_t lease_field_offset(std::true_type) const
+    {
+      return offset_between(&this->buffer[0], &this->buffer[0].lease_position);
+    }
+
+    std::uint64_t lease_field_offset(std::false_type) const
+    {
+      return 0;
+    }
+
+    std::uint64_t expiry_field_offset() const
+    {
+      return expiry_field_offset(std::integral_constant<bool, ttl_enabled>());
+    }
+
+    std::uint64_t expiry_field_offset(std::true_type) const
+    {
+      return offset_between(&this->buffer[0], &this->buffer[0].expires_at);
+    }
+
+    std::uint64_t expiry_field_offset(std::false_type) const
+    {
+      return 0;
+    }
+
+    // Fill in the layout description of a freshly initialized segment
+    void describe_layout()
+    {
+      Queue_Layout& layout = this->control_block->layout;
+
+      layout.version = queue_layout_version;
+      layout.features = Features;
+      layout.index_size = sizeof(std::size_t);
+      layout.capacity = Capacity;
+      layout.item_size = sizeof(T);
+      layout.slot_size = sizeof(Buffer_Slot);
+      layout.head_offset = offset_between(this->control_block, &this->control_block->head);
+      layout.tail_offset = offset_between(this->control_block, &this->control_block->tail);
+      layout.buffer_offset = offset_between(this->control_block, this->buffer);
+      layout.sequence_offset = offset_between(&this->buffer[0], &this->buffer[0].sequence);
+      layout.item_offset = offset_between(&this->buffer[0], &this->buffer[0].data);
+      layout.important_offset = offset_between(&this->buffer[0], &this->buffer[0].is_important);
+
+      if (stats_enabled)
+      {
+        layout.high_water_offset = offset_between(this->control_block, &this->stats_block->high_water);
+        layout.shards_offset = offset_between(this->control_block, &this->stats_block->shards[0]);
+        layout.shard_size = sizeof(Stats_Shard);
+        layout.shard_count = SQ_STATS_SHARDS;
+      }
+
+      if (latency_enabled)
+      {
+        layout.histogram_offset = offset_between(this->control_block, this->latency_block);
+        layout.histogram_buckets = static_cast<std::uint32_t>(Latency_Histogram::bucket_count);
+#if defined(SQ_LATENCY_USE_TSC)
+        layout.histogram_unit = 1;
+#endif
+      }
+
+      if (leases_enabled)
+      {
+        layout.lease_offset = lease_field_offset();
+      }
+
+      if (ttl_enabled)
+      {
+        layout.expiry_offset = expiry_field_offset();
+      }
+
+      if (owners_enabled)
+      {
+        layout.owners_offset = offset_between(this->control_block, this->owner_block);
+        layout.owner_size = static_cast<std::uint32_t>(sizeof(Owner_Entry));
+        layout.owner_count = SQ_OWNER_SLOTS;
+      }
+
+      layout.total_size = required_size();
+      layout.magic = queue_layout_magic;
+    }
+
+    // Add amount to one of this handle's counters
+    void record(std::atomic<std::uint64_t> Stats_Shard::* counter, std::uint64_t amount = 1)
+    {
+      if (stats_enabled)
+      {
+        (this->stats_shard->*counter).fetch_add(amount, std::memory_order_relaxed);
+      }
+    }
+
+    void record_high_water(std::size_t count)
+    {
+      if (stats_enabled)
+      {
+        std::uint64_t high_water = this->stats_block->high_water.load(std::memory_order_relaxed);
+
+        while (count > high_water &&
+          !this->stats_block->high_water.compare_exchange_weak(high_water, count, std::memory_order_relaxed))
+        {
+        }
+      }
+    }
+
+    // Flush the retries of one operation; most operations have none
+    void record_contention(Contention_Shard Stats_Shard::* operation, const Retry_Counts& retries)
+    {
+      if (contention_enabled && (retries.cas_failures | retries.spins) != 0)
+      {
+        Contention_Shard& shard = this->stats_shard->*operation;
+        shard.cas_failures.fetch_add(retries.cas_failures, std::memory_order_relaxed);
+        shard.spins.fetch_add(retries.spins, std::memory_order_relaxed);
+        shard.parks.fetch_add(retries.parks, std::memory_order_relaxed);
+      }
+    }
+
+    // Move an item in or out of a slot. Trivially copyable types are copied
+    // as raw bytes; is_shareable specializations use their copy assignment.
+    static void copy_item(T* destination, const T* source)
+    {
+      copy_item(destination, source, std::is_trivially_copyable<T>());
+    }
+
+    static void copy_item(T* destination, const T* source, std::true_type)
+    {
+      std::memcpy(static_cast<void*>(destination), static_cast<const void*>(source), sizeof(T));
+    }
+
+    static void copy_item(T* destination, const T* source, std::false_type)
+    {
+      *destination = *source;
+    }
+
+    // Prefetch the slot SQ_PREFETCH_DISTANCE positions after pos, if it holds
+    // one of the available items, so a consumer draining a backlog does not
+    // start cold on every slot
+    void prefetch_ahead(std::size_t pos, std::size_t available) const
+    {
+      if (SQ_PREFETCH_DISTANCE != 0 && SQ_PREFETCH_DISTANCE < available)
+      {
+        detail::prefetch_read(&this->buffer[wrap(pos + SQ_PREFETCH_DISTANCE)], sizeof(Buffer_Slot));
+      }
+    }
+
+    // Copy count items out of the contiguous slots starting at index.
+    // Trivially copyable items go through the vectorized gather kernel.
+    void copy_out(T* items, std::size_t index, std::size_t count, std::true_type) const
+    {
+      detail::gather_copy(items, &this->buffer[index].data, count, sizeof(T), sizeof(Buffer_Slot),
+        offset_between(&this->buffer[0], &this->buffer[0].data));
+    }
+
+    void copy_out(T* items, std::size_t index, std::size_t count, std::false_type) const
+    {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        this->prefetch_ahead(index + i, count - i);
+        copy_item(&items[i], &this->buffer[index + i].data);
+      }
+    }
+
+    // Whether a registered handle of a live process is trying to take pos.
+    // alive[i] tells whether the process of entry i exists.
+    bool claimed_by_live_owner(std::size_t pos, const bool* alive) const
+    {
+      for (std::size_t i = 0; i < SQ_OWNER_SLOTS; ++i)
+      {
+        const Owner_Entry& entry = this->owner_block->entries[i];
+
+        if (!alive[i] || entry.pid.load(std::memory_order_acquire) == 0)
+        {
+          continue;
+        }
+
+        std::size_t consuming = entry.consuming.load(std::memory_order_relaxed);
+
+        if (entry.producing.load(std::memory_order_relaxed) == pos + 1 ||
+          (consuming != 0 && pos - (consuming - 1) < entry.consuming_count.load(std::memory_order_relaxed)))
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    // back_off() for a full queue whose oldest slot is held by another
+    // handle. With feature_owners, long waits check whether that handle's
+    // process died, and with feature_leases whether its lease expired, so
+    // producers do not spin forever behind it.
+    void wait_for_owner(Retry_Counts& retries, std::size_t pos)
+    {
+      std::uint64_t parks = retries.parks;
+      back_off(retries);
+
+      if (parks == 0 && retries.parks != 0)
+      {
+        // First yield; the wait is no longer a short spin
+        retries.blocked_on = pos;
+        SQ_PROBE3(block, this->control_block, pos, this->size());
+      }
+
+      if ((owners_enabled || leases_enabled) && retries.spins % (SQ_SPIN_LIMIT * 64) == 0)
+      {
+        this->recover_abandoned();
+        this->redeliver_expired();
+      }
+    }
+
+    // Pair a block probe from wait_for_owner() with its wake
+    void end_wait(const Retry_Counts& retries) const
+    {
+      if (retries.parks != 0)
+      {
+        SQ_PROBE3(wake, this->control_block, retries.blocked_on, this->size());
+      }
+    }
+
+    // Make room in a full queue by claiming the oldest item the way a
+    // consumer would and discarding it. Returns without evicting if the
+    // queue is no longer full, or if the oldest item is still being written
+    // or read by another thread; the caller then retries its enqueue.
+    // Returns false if it had to wait for another thread, so the caller can
+    // bound how long it waits.
+    bool evict_oldest(Retry_Counts& retries)
+    {
+      std::size_t oldest = this->control_block->head.load(std::memory_order_relaxed);
+
+      if (this->control_block->tail.load(std::memory_order_relaxed) - oldest < Capacity)
+      {
+        // A consumer has claimed the slot we want but not handed it over yet
+        this->wait_for_owner(retries, oldest);
+        return false;
+      }
+
+      Buffer_Slot& victim = this->buffer[wrap(oldest)];
+
+      if (victim.sequence.load(std::memory_order_acquire) != oldest + 1)
+      {
+        // The oldest position is reserved but not published yet
+        this->wait_for_owner(retries, oldest);
+        return false;
+      }
+
+      this->owner.note_consuming(oldest, 1);
+
+      if (!this->control_block->head.compare_exchange_strong(oldest, oldest + 1, claim_order, std::memory_order_relaxed))
+      {
+        ++retries.cas_failures;
+        return true;
+      }
+
+      if (this->is_expired(victim))
+      {
+        // Nothing of value was lost
+        this->discard_expired(&victim, oldest);
+      }
+      else
+      {
+        bool evicting_important = victim.is_important.load(std::memory_order_relaxed);
+        victim.sequence.store(oldest + Capacity, std::memory_order_release);
+
+        this->record(evicting_important ? &Stats_Shard::evicted_important : &Stats_Shard::evicted_unimportant);
+        SQ_PROBE3(overflow, this->control_block, oldest, evicting_important);
+      }
+
+      // Expired items right behind it are worth nothing either. Free them
+      // too, so the producers that follow do not each find the queue full
+      // and evict a live item.
+      while (ttl_enabled)
+      {
+        oldest = this->control_block->head.load(std::memory_order_relaxed);
+        Buffer_Slot& next = this->buffer[wrap(oldest)];
+
+        if (next.sequence.load(std::memory_order_acquire) != oldest + 1 || !this->is_expired(next))
+        {
+          break;
+        }
+
+        this->owner.note_consuming(oldest, 1);
+
+        if (!this->control_block->head.compare_exchange_strong(oldest, oldest + 1, claim_order, std::memory_order_relaxed))
+        {
+          break;
+        }
+
+        this->discard_expired(&next, oldest);
+      }
+
+      return true;
+    }
+
+    // Whether the item in a claimed or published slot has passed its
+    // expiry time. The clock is only read for items that have one.
+    bool is_expired(const Buffer_Slot& slot) const
+    {
+      std::uint64_t expiry = slot.expiry();
+      return (expiry != 0 && expiry <= detail::steady_ns());
+    }
+
+    bool is_expired(const Buffer_Slot& slot, std::uint64_t now) const
+    {
+      std::uint64_t expiry = slot.expiry();
+      return (expiry != 0 && expiry <= now);
+    }
+
+    // Hand the claimed slot of an expired item back to producers unread
+    void discard_expired(Buffer_Slot* slot, std::size_t pos)
+    {
+      bool important = slot->is_important.load(std::memory_order_relaxed);
+      slot->sequence.store(pos + Capacity, std::memory_order_release);
+
+      this->record(&Stats_Shard::expired);
+      SQ_PROBE3(expired, this->control_block, pos, important);
+    }
+
+    // Shared by dequeue() and lease(). With a lease, the slot stays claimed
+    // and is stamped with it instead of being handed back to producers.
+    bool dequeue_item(T* item, bool* important, Queue_Lease* lease, std::uint64_t deadline)
+    {
+      if (!this->is_operational())
+      {
+        return false;
+      }
+
+      Retry_Counts retries;
+      std::size_t pos = this->control_block->head.load(std::memory_order_relaxed);
+      Buffer_Slot* slot = nullptr;
+
+      while (true)
+      {
+        slot = &this->buffer[wrap(pos)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+
+        if (difference == 0)
+        {
+          // Item is published; try to claim it
+          this->owner.note_consuming(pos, 1);
+
+          if (this->control_block->head.compare_exchange_weak(pos, pos + 1, claim_order, std::memory_order_relaxed))
+          {
+            if (!this->is_expired(*slot))
+            {
+              break;
+            }
+
+            // Drop it unread and try the next one
+            this->discard_expired(slot, pos);
+            pos = this->control_block->head.load(std::memory_order_relaxed);
+            continue;
+          }
+
+          ++retries.cas_failures;
+        }
+        else if (difference < 0)
+        {
+          // Queue is empty, or the item at head is not published yet
+          this->record(&Stats_Shard::empty_polls);
+          this->record_contention(&Stats_Shard::dequeue_contention, retries);
+          SQ_PROBE1(empty, this->control_block);
+          return false;
+        }
+        else
+        {
+          // Another consumer (or an evicting producer) took this position
+          ++retries.cas_failures;
+          pos = this->control_block->head.load(std::memory_order_relaxed);
+        }
+      }
+
+      std::size_t available = this->control_block->tail.load(std::memory_order_relaxed) - pos;
+
+      this->prefetch_ahead(pos, available);
+      copy_item(item, &slot->data);
+
+      std::uint64_t published = slot->published();
+
+      if (important != nullptr)
+      {
+        *important = slot->is_important.load(std::memory_order_relaxed);
+      }
+
+      if (lease != nullptr)
+      {
+        // Keep the slot until ack() or the deadline
+        this->stamp_lease(slot, pos, deadline);
+        lease->position = pos;
+      }
+      else
+      {
+        // Hand the slot to producers for the next lap
+        slot->sequence.store(pos + Capacity, std::memory_order_release);
+      }
+
+      this->record(&Stats_Shard::dequeued);
+      this->record_contention(&Stats_Shard::dequeue_contention, retries);
+      SQ_PROBE3(dequeue, this->control_block, pos, available - 1);
+
+      if (latency_enabled && published != 0)
+      {
+        this->record_delay(published, detail::read_clock());
+      }
+
+      return true;
+    }
+
+    bool is_leased(const Buffer_Slot&, std::size_t, std::false_type) const
+    {
+      return false;
+    }
+
+    bool is_leased(const Buffer_Slot& slot, std::size_t pos, std::true_type) const
+    {
+      return (slot.lease_position.load(std::memory_order_acquire) == pos + 1);
+    }
+
+    bool is_leased(const Buffer_Slot& slot, std::size_t pos) const
+    {
+      return this->is_leased(slot, pos, std::integral_constant<bool, leases_enabled>());
+    }
+
+    void stamp_lease(Buffer_Slot*, std::size_t, std::uint64_t, std::false_type)
+    {
+    }
+
+    void stamp_lease(Buffer_Slot* slot, std::size_t pos, std::uint64_t deadline, std::true_type)
+    {
+      slot->lease_deadline.store(deadline, std::memory_order_relaxed);
+      slot->lease_position.store(pos + 1, std::memory_order_release);
+    }
+
+    void stamp_lease(Buffer_Slot* slot, std::size_t pos, std::uint64_t deadline)
+    {
+      this->stamp_lease(slot, pos, deadline, std::integral_constant<bool, leases_enabled>());
+    }
+
+    std::size_t redeliver_expired(std::false_type)
+    {
+      return 0;
+    }
+
+    std::size_t redeliver_expired(std::true_type)
+    {
+      if (!this->is_operational() || this->lease_scan.running.exchange(true, std::memory_order_acquire))
+      {
+        // The enqueues would be refused, or reached again through a full
+        // enqueue of our own redelivery (or another thread is redelivering)
+        return 0;
+      }
+
+      std::uint64_t now = detail::steady_ns();
+      std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+      std::size_t redelivered = 0;
+
+      for (std::size_t i = 0; i < Capacity; ++i)
+      {
+        Buffer_Slot& slot = this->buffer[i];
+        std::size_t leased = slot.sequence.load(std::memory_order_acquire);
+        std::size_t pos = leased - 1;
+
+        // Leased: claimed (behind head), stamped for this position and past
+        // its deadline. Sequence 0 is slot 0 before its first item.
+        if (leased == 0 || static_cast<std::ptrdiff_t>(head - pos) <= 0 ||
+          slot.lease_position.load(std::memory_order_acquire) != leased ||
+          slot.lease_deadline.load(std::memory_order_relaxed) > now)
+        {
+          continue;
+        }
+
+        // Take the lease away from its holder; exactly one of this and ack() succeeds
+        if (!slot.lease_position.compare_exchange_strong(leased, 0, std::memory_order_acq_rel))
+        {
+          continue;
+        }
+
+        T item;
+        copy_item(&item, &slot.data);
+        bool important = slot.is_important.load(std::memory_order_relaxed);
+        std::uint64_t expiry = slot.expiry();
+
+        // Release the slot first; the enqueue may need it if the queue is full
+        slot.sequence.store(pos + Capacity, std::memory_order_release);
+
+        if (!this->enqueue_item(item, important, false, expiry))
+        {
+          // Full with a stalled oldest slot; the item is lost like an evicted one
+          this->record(important ? &Stats_Shard::evicted_important : &Stats_Shard::evicted_unimportant);
+          SQ_PROBE3(overflow, this->control_block, pos, important);
+          continue;
+        }
+
+        ++redelivered;
+        SQ_PROBE3(redelivered, this->control_block, pos, important);
+      }
+
+      this->lease_scan.running.store(false, std::memory_order_release);
+      return redelivered;
+    }
+
+    // Used by recover(): move the items of leases that were never
+    // acknowledged to the positions right before head, in their order, and
+    // clear every lease stamp. Returns the new head.
+    std::size_t requeue_leased(std::size_t head, std::size_t, std::false_type)
+    {
+      return head;
+    }
+
+    std::size_t requeue_leased(std::size_t head, std::size_t tail, std::true_type)
+    {
+      // Leased items sit between the oldest position producers have not
+      // reused yet and head. Going down from head, each moves up next to
+      // the ones already moved.
+      std::size_t lowest = (tail >= Capacity) ? tail - Capacity : 0;
+      std::size_t target = head;
+
+      for (std::size_t pos = head; pos != lowest;)
+      {
+        --pos;
+        Buffer_Slot& slot = this->buffer[wrap(pos)];
+
+        if (slot.sequence.load(std::memory_order_relaxed) != pos + 1 ||
+          slot.lease_position.load(std::memory_order_relaxed) != pos + 1)
+        {
+          continue;
+        }
+
+        if (--target != pos)
+        {
+          this->move_slot(&this->buffer[wrap(target)], slot);
+        }
+      }
+
+      for (std::size_t i = 0; i < Capacity; ++i)
+      {
+        this->buffer[i].lease_position.store(0, std::memory_order_relaxed);
+      }
+
+      return target;
+    }
+
+    // Copy the item of source and everything describing it into target
+    static void move_slot(Buffer_Slot* target, const Buffer_Slot& source)
+    {
+      copy_item(&target->data, &source.data);
+      target->set_published(source.published());
+      target->set_expiry(source.expiry());
+      target->is_important.store(source.is_important.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // Copy the run of count items claimed at pos into items and hand its
+    // slots back to producers. Expired items are left out, those at the
+    // front of the run without being copied. Returns the number of items
+    // copied.
+    std::size_t take_run(T* items, bool* important, std::size_t pos, std::size_t count)
+    {
+      std::uint64_t now = ttl_enabled ? detail::steady_ns() : 0;
+      std::size_t expired = 0;
+
+      while (ttl_enabled && expired < count && this->is_expired(this->buffer[wrap(pos + expired)], now))
+      {
+        this->discard_expired(&this->buffer[wrap(pos + expired)], pos + expired);
+        ++expired;
+      }
+
+      pos += expired;
+      count -= expired;
+
+      // Copy the range in at most two contiguous parts, split where the ring wraps
+      std::size_t first = Capacity - wrap(pos);
+      first = (first < count) ? first : count;
+
+      this->copy_out(items, wrap(pos), first, std::is_trivially_copyable<T>());
+      this->copy_out(items + first, 0, count - first, std::is_trivially_copyable<T>());
+
+      if (important != nullptr)
+      {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          important[i] = this->buffer[wrap(pos + i)].is_important.load(std::memory_order_relaxed);
+        }
+      }
+
+      if (latency_enabled)
+      {
+        // The whole batch left the queue now; read the clock once
+        std::uint64_t clock = detail::read_clock();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          const Buffer_Slot& slot = this->buffer[wrap(pos + i)];
+
+          if (!this->is_expired(slot, now))
+          {
+            this->record_delay(slot.published(), clock);
+          }
+        }
+      }
+
+      std::size_t kept = count;
 
-    Shared_Control_Block* control_block{ nullptr }; // Shared control block
-    Buffer_Slot* buffer{ nullptr };                 // Circular buffer slots
+      if (ttl_enabled)
+      {
+        // Close the gaps left by items with a shorter TTL than those before them
+        kept = 0;
 
-    std::size_t wrap(std::size_t index) const
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          Buffer_Slot& slot = this->buffer[wrap(pos + i)];
+
+          if (this->is_expired(slot, now))
+          {
+            this->record(&Stats_Shard::expired);
+            SQ_PROBE3(expired, this->control_block, pos + i, slot.is_important.load(std::memory_order_relaxed));
+            continue;
+          }
+
+          if (kept != i)
+          {
+            copy_item(&items[kept], &items[i]);
+
+            if (important != nullptr)
+            {
+              important[kept] = important[i];
+            }
+          }
+
+          ++kept;
+        }
+      }
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        this->buffer[wrap(pos + i)].sequence.store(pos + i + Capacity, std::memory_order_release);
+      }
+
+      return kept;
+    }
+
+    // Shared by enqueue(), enqueue_streaming() and enqueue_with_ttl()
+    bool enqueue_item(const T& item, bool important, bool streaming, std::uint64_t expiry)
     {
-      return index % Capacity; // Use Capacity as the capacity
+      if (!this->is_operational())
+      {
+        return false;
+      }
+
+      Retry_Counts retries;
+      bool found_full = false;
+      std::size_t full_waits = 0;
+      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
+      Buffer_Slot* slot = nullptr;
+
+      while (true)
+      {
+        slot = &this->buffer[wrap(pos)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - pos);
+
+        if (difference == 0)
+        {
+          // Slot is free for this position; try to reserve it
+          this->owner.note_producing(pos);
+
+          if (this->control_block->tail.compare_exchange_weak(pos, pos + 1, claim_order, std::memory_order_relaxed))
+          {
+            break;
+          }
+
+          ++retries.cas_failures;
+        }
+        else if (difference < 0)
+        {
+          // Slot still holds the item from the previous lap; queue is full
+          found_full = true;
+
+          // The last wait may have recovered the slot (see wait_for_owner()),
+          // so retry once more after it
+          if (!this->evict_oldest(retries) && ++full_waits > SQ_FULL_WAIT_LIMIT)
+          {
+            // The thread holding the oldest slot stalled; do not stall with it
+            this->record(&Stats_Shard::full_hits);
+            this->record_contention(&Stats_Shard::enqueue_contention, retries);
+            this->end_wait(retries);
+            return false;
+          }
+
+          pos = this->control_block->tail.load(std::memory_order_relaxed);
+        }
+        else
+        {
+          // Another producer took this position
+          ++retries.cas_failures;
+          pos = this->control_block->tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      // Write data to the reserved slot
+      if (streaming)
+      {
+        detail::stream_copy(&slot->data, &item, sizeof(T));
+        detail::stream_fence();
+      }
+      else
+      {
+        copy_item(&slot->data, &item);
+      }
+
+      slot->set_published(sample_publish_time());
+      slot->set_expiry(expiry);
+      slot->is_important.store(important, std::memory_order_relaxed);
+      slot->sequence.store(pos + 1, std::memory_order_release);
+
+      if (found_full)
+      {
+        this->record(&Stats_Shard::full_hits);
+      }
+
+      this->record(&Stats_Shard::enqueued);
+      this->record_contention(&Stats_Shard::enqueue_contention, retries);
+
+      if (stats_enabled)
+      {
+        this->record_high_water(this->size());
+      }
+
+      SQ_PROBE3(enqueue, this->control_block, pos, this->size());
+      this->end_wait(retries);
+
+      if (!streaming)
+      {
+        // Get the next slot we are going to write on its way
+        detail::prefetch_write(&this->buffer[wrap(pos + 1)], sizeof(Buffer_Slot));
+      }
+
+      return true;
     }
 
   public:
     constexpr static std::size_t required_size()
     {
-      return sizeof(Shared_Control_Block) + (sizeof(Buffer_Slot) * Capacity);
+      return (stats_enabled || latency_enabled || owners_enabled)
+        ? owners_offset() + (owners_enabled ? sizeof(Shared_Owner_Block) : 0)
+        : aligned_control_size() + (sizeof(Buffer_Slot) * Capacity);
     }
 
     // Check if the buffer is empty
     bool is_empty() const
     {
-      return (this->control_block->count.load(std::memory_order_acquire) == 0);
+      return (this->size() == 0);
     }
 
-    // Count of items in the buffer
+    // Count of items in the buffer, including reserved but unpublished ones
     std::size_t size() const
     {
-      return this->control_block->count.load(std::memory_order_acquire);
+      // Load head first, so tail can only be ahead of it
+      std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+      std::size_t tail = this->control_block->tail.load(std::memory_order_acquire);
+      return (tail - head < Capacity) ? tail - head : Capacity;
     }
 
-    // Enqueue a new item
+    // Enqueue a new item. Overwrites the oldest item if the queue is full.
+    // Returns false, without enqueuing, only if the queue is full and the
+    // oldest slot stays held by another thread (mid-write or mid-read) for
+    // SQ_FULL_WAIT_LIMIT waits.
     bool enqueue(const T& item, bool important = false)
     {
-      std::size_t current_count = this->control_block->count.load(std::memory_order_acquire);
+      return this->enqueue_item(item, important, false, 0);
+    }
+
+    // Enqueue a new item, writing it with non-temporal stores when T is at
+    // least SQ_STREAMING_THRESHOLD bytes. Keeps large payloads that are only
+    // read by consumers out of the producer's cache.
+    bool enqueue_streaming(const T& item, bool important = false)
+    {
+      static_assert(std::is_trivially_copyable<T>::value, "enqueue_streaming() requires a trivially copyable T");
+      return this->enqueue_item(item, important, sizeof(T) >= SQ_STREAMING_THRESHOLD, 0);
+    }
+
+    // Enqueue a new item that is only worth dequeuing for ttl_ns
+    // nanoseconds. After that, dequeue(), dequeue_bulk() and lease() drop it
+    // unread and count it in Queue_Stats::expired, and a full enqueue
+    // discards it (and any expired items right behind it) instead of
+    // evicting a live item. Requires feature_ttl.
+    bool enqueue_with_ttl(const T& item, std::uint64_t ttl_ns, bool important = false)
+    {
+      static_assert(ttl_enabled, "enqueue_with_ttl() requires feature_ttl");
+      return this->enqueue_item(item, important, false, detail::steady_ns() + ttl_ns);
+    }
+
+    // Dequeue an item. Returns false if no published item is available.
+    bool dequeue(T* item, bool* important = nullptr)
+    {
+      return this->dequeue_item(item, important, nullptr, 0);
+    }
+
+    // Take the item at head like dequeue(), but keep its slot until ack()
+    // is called with lease. If that does not happen within timeout_ns (a
+    // consumer crashed or stalled), the item is enqueued again for another
+    // consumer: at-least-once delivery. Requires feature_leases.
+    //
+    // A leased slot is not reused until it is acknowledged or expires, so
+    // producers that wrap around to it wait; keep timeouts short relative
+    // to how long the queue takes to fill. Every SQ_LEASE_SCAN_NS a handle
+    // calling lease() also redelivers expired leases.
+    bool lease(T* item, Queue_Lease* lease, std::uint64_t timeout_ns, bool* important = nullptr)
+    {
+      static_assert(leases_enabled, "lease() requires feature_leases");
+
+      std::uint64_t now = detail::steady_ns();
 
-      if (current_count == Capacity)
+      if (this->lease_scan.is_due(now))
       {
-        // Queue is full; search for a non-important slot to overwrite
-        std::size_t search_pos = this->control_block->head.load(std::memory_order_relaxed);
-        bool found_non_important = false;
+        this->redeliver_expired();
+      }
 
-        for (std::size_t i = 0; i < Capacity; ++i)
+      return this->dequeue_item(item, important, lease, now + timeout_ns);
+    }
+
+    // Release a leased item for good. Returns false if the lease had
+    // already expired and the item was redelivered (or is being), in which
+    // case another consumer will see it again.
+    bool ack(const Queue_Lease& lease)
+    {
+      static_assert(leases_enabled, "ack() requires feature_leases");
+
+      Buffer_Slot& slot = this->buffer[wrap(lease.position)];
+      std::size_t leased = lease.position + 1;
+
+      if (!slot.lease_position.compare_exchange_strong(leased, 0, std::memory_order_acq_rel))
+      {
+        return false;
+      }
+
+      slot.sequence.store(lease.position + Capacity, std::memory_order_release);
+      return true;
+    }
+
+    // Enqueue the items of expired leases again and release their slots.
+    // Items go to the tail, so a redelivered item comes after the ones
+    // enqueued meanwhile, and like any enqueue it overwrites the oldest item
+    // if the queue is full. Returns the number of items redelivered; always
+    // 0 without feature_leases.
+    std::size_t redeliver_expired()
+    {
+      return this->redeliver_expired(std::integral_constant<bool, leases_enabled>());
+    }
+
+    // Dequeue up to max_items items into items, and their importance into
+    // important[0..n) if it is not null. Claims the run of published items
+    // at head with a single CAS. Returns the number of items dequeued.
+    std::size_t dequeue_bulk(T* items, std::size_t max_items, bool* important = nullptr)
+    {
+      if (max_items == 0 || !this->is_operational())
+      {
+        return 0;
+      }
+
+      Retry_Counts retries;
+      std::size_t pos = this->control_block->head.load(std::memory_order_relaxed);
+      std::size_t count = 0;
+      std::size_t kept = 0;
+
+      while (true)
+      {
+        std::size_t sequence = this->buffer[wrap(pos)].sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+
+        if (difference < 0)
+        {
+          // Queue is empty, or the item at head is not published yet
+          this->record(&Stats_Shard::empty_polls);
+          this->record_contention(&Stats_Shard::dequeue_contention, retries);
+          SQ_PROBE1(empty, this->control_block);
+          return 0;
+        }
+
+        if (difference > 0)
+        {
+          ++retries.cas_failures;
+          pos = this->control_block->head.load(std::memory_order_relaxed);
+          continue;
+        }
+
+        // Extend the run over the published items that follow
+        count = 1;
+
+        while (count < max_items &&
+          this->buffer[wrap(pos + count)].sequence.load(std::memory_order_acquire) == pos + count + 1)
+        {
+          ++count;
+        }
+
+        this->owner.note_consuming(pos, count);
+
+        if (this->control_block->head.compare_exchange_weak(pos, pos + count, claim_order, std::memory_order_relaxed))
         {
-          Buffer_Slot& candidate_slot = this->buffer[wrap(search_pos)];
+          kept = this->take_run(items, important, pos, count);
 
-          if (!candidate_slot.is_important.load(std::memory_order_acquire))
+          if (kept != 0)
           {
-            found_non_important = true;
             break;
           }
 
-          search_pos = wrap(search_pos + 1);
+          // Every item of the run had expired; look for more
+          pos = this->control_block->head.load(std::memory_order_relaxed);
+          continue;
+        }
+
+        ++retries.cas_failures;
+      }
+
+      this->record(&Stats_Shard::dequeued, kept);
+      this->record_contention(&Stats_Shard::dequeue_contention, retries);
+      SQ_PROBE3(dequeue_bulk, this->control_block, pos, kept);
+
+      return kept;
+    }
+
+    // Counters summed over all shards. All zero unless Features includes
+    // feature_stats. Shards are read one by one while other handles keep
+    // counting, so the totals are not an atomic snapshot.
+    Queue_Stats stats() const
+    {
+      Queue_Stats result;
+
+      if (stats_enabled)
+      {
+        for (const Stats_Shard& shard : this->stats_block->shards)
+        {
+          result.enqueued += shard.enqueued.load(std::memory_order_relaxed);
+          result.dequeued += shard.dequeued.load(std::memory_order_relaxed);
+          result.evicted_important += shard.evicted_important.load(std::memory_order_relaxed);
+          result.evicted_unimportant += shard.evicted_unimportant.load(std::memory_order_relaxed);
+          result.full_hits += shard.full_hits.load(std::memory_order_relaxed);
+          result.empty_polls += shard.empty_polls.load(std::memory_order_relaxed);
+          result.expired += shard.expired.load(std::memory_order_relaxed);
         }
 
-        if (found_non_important)
+        result.high_water = this->stats_block->high_water.load(std::memory_order_relaxed);
+      }
+
+      return result;
+    }
+
+    // Retry counters of the CAS loops summed over all shards. All zero unless
+    // Features includes feature_contention. Compare them with stats() to get
+    // retries per operation.
+    Contention_Snapshot contention_snapshot() const
+    {
+      Contention_Snapshot result;
+
+      if (contention_enabled)
+      {
+        for (const Stats_Shard& shard : this->stats_block->shards)
         {
-          // Move head to free up the non-important slot
-          this->control_block->head.store(
-            wrap(this->control_block->head.load(std::memory_order_relaxed) + 1),
-            std::memory_order_release
-          );
+          result.enqueue.cas_failures += shard.enqueue_contention.cas_failures.load(std::memory_order_relaxed);
+          result.enqueue.spins += shard.enqueue_contention.spins.load(std::memory_order_relaxed);
+          result.enqueue.parks += shard.enqueue_contention.parks.load(std::memory_order_relaxed);
+          result.dequeue.cas_failures += shard.dequeue_contention.cas_failures.load(std::memory_order_relaxed);
+          result.dequeue.spins += shard.dequeue_contention.spins.load(std::memory_order_relaxed);
+          result.dequeue.parks += shard.dequeue_contention.parks.load(std::memory_order_relaxed);
+        }
+      }
+
+      return result;
+    }
+
+    // Snapshot of the enqueue-to-dequeue delay histogram, filled from one in
+    // SQ_LATENCY_SAMPLE_RATE items. All zero unless Features includes
+    // feature_latency.
+    Latency_Histogram latency() const
+    {
+      Latency_Histogram result;
 
-          // If we forced out an item, the count *doesn't change*
-          // because we are about to place a new one. So effectively
-          // we do a 'dequeue + enqueue' on the same operation.
-          // But let's forcibly decrement then increment to be consistent.
-          this->control_block->count.fetch_sub(1, std::memory_order_acq_rel);
+      if (latency_enabled)
+      {
+        for (std::size_t i = 0; i < Latency_Histogram::bucket_count; ++i)
+        {
+          result.counts[i] = this->latency_block->counts[i].load(std::memory_order_relaxed);
         }
-        else
+      }
+
+      return result;
+    }
+
+    // Whether shared_memory holds an initialized queue with exactly this
+    // layout (same T size, Capacity, Features and build). Unlike create(),
+    // which initializes any segment whose capacity does not match, this lets
+    // callers refuse a segment instead of wiping it.
+    static bool matches_layout(const void* shared_memory)
+    {
+      const Queue_Layout& layout = static_cast<const Shared_Control_Block*>(shared_memory)->layout;
+
+      return layout.magic == queue_layout_magic &&
+        layout.version == queue_layout_version &&
+        layout.features == Features &&
+        layout.index_size == sizeof(std::size_t) &&
+        layout.capacity == Capacity &&
+        layout.item_size == sizeof(T) &&
+        layout.slot_size == sizeof(Buffer_Slot) &&
+        layout.total_size == required_size() &&
+        static_cast<const Shared_Control_Block*>(shared_memory)->capacity == Capacity;
+    }
+
+    // Bring a queue left behind by crashed processes back into a consistent
+    // state. Positions that were reserved but never published (partially
+    // written items) are dropped and the published items behind them are
+    // moved up, preserving their order. Items a consumer had claimed but not
+    // released count as consumed, except leased items (see feature_leases)
+    // that were never acknowledged: those are queued again in front of the
+    // others, since they are older. Returns the number of dropped positions.
+    //
+    // Must only be called while no other thread or process uses the queue,
+    // e.g. when reopening a persistent segment after a crash or reboot.
+    std::size_t recover()
+    {
+      std::size_t head = this->control_block->head.load(std::memory_order_relaxed);
+      std::size_t tail = this->control_block->tail.load(std::memory_order_relaxed);
+
+      if (tail - head > Capacity)
+      {
+        // Positions are corrupt; nothing between them can be trusted
+        tail = head + Capacity;
+      }
+
+      std::size_t kept = head;
+
+      for (std::size_t pos = head; pos != tail; ++pos)
+      {
+        Buffer_Slot& slot = this->buffer[wrap(pos)];
+
+        if (slot.sequence.load(std::memory_order_relaxed) != pos + 1)
         {
-          // No non-important slots found; overwrite the oldest important slot
-          this->control_block->head.store(
-            wrap(this->control_block->head.load(std::memory_order_relaxed) + 1),
-            std::memory_order_release
-          );
+          continue;
+        }
 
-          this->control_block->count.fetch_sub(1, std::memory_order_acq_rel);
+        if (kept != pos)
+        {
+          this->move_slot(&this->buffer[wrap(kept)], slot);
         }
+
+        ++kept;
       }
 
-      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
-      std::size_t next_pos = wrap(pos + 1);
+      head = this->requeue_leased(head, tail, std::integral_constant<bool, leases_enabled>());
+      this->control_block->head.store(head, std::memory_order_relaxed);
 
-      // Write data to the current tail
-      this->buffer[wrap(pos)].data = item;
-      this->buffer[wrap(pos)].is_important.store(important, std::memory_order_release);
-      this->control_block->tail.store(next_pos, std::memory_order_release);
+      // Published items occupy [head, kept); every other slot is free for
+      // the next position that maps to it
+      for (std::size_t pos = head; pos != head + Capacity; ++pos)
+      {
+        this->buffer[wrap(pos)].sequence.store((pos < kept) ? pos + 1 : pos, std::memory_order_relaxed);
+      }
 
-      this->control_block->count.fetch_add(1, std::memory_order_acq_rel);
+      this->control_block->tail.store(kept, std::memory_order_relaxed);
 
-      return true;
+      if (owners_enabled)
+      {
+        // Registrations from before the crash are meaningless now
+        for (Owner_Entry& entry : this->owner_block->entries)
+        {
+          entry.pid.store((&entry == this->owner.registered()) ? detail::current_process_id() : 0, std::memory_order_relaxed);
+        }
+      }
+
+      std::atomic_thread_fence(std::memory_order_release);
+
+      return tail - kept;
     }
 
-    // Dequeue an item
-    bool dequeue(T* item, bool* important = nullptr)
+    // Reclaim slots abandoned by registered handles (see feature_owners)
+    // whose process has died in the middle of an operation, so the queue
+    // does not stall behind them:
+    // - An item a dead consumer claimed but never released is handed back
+    //   to producers; the item is lost.
+    // - A position a dead producer reserved but never published is skipped
+    //   once it reaches head; until then items queued before it can still
+    //   be dequeued. Call this again later to skip it.
+    // Entries of dead processes are freed once nothing of theirs is left.
+    // Safe to call at any time from any process, e.g. from a watchdog timer.
+    // Producers blocked by a full queue call it on their own. Returns the
+    // number of positions reclaimed; always 0 without feature_owners.
+    std::size_t recover_abandoned()
     {
-      std::size_t current_count = this->control_block->count.load(std::memory_order_acquire);
+      if (!owners_enabled)
+      {
+        return 0;
+      }
+
+      bool alive[SQ_OWNER_SLOTS];
+      std::uint64_t pids[SQ_OWNER_SLOTS];
+      bool any_dead = false;
 
-      if (current_count == 0)
+      for (std::size_t i = 0; i < SQ_OWNER_SLOTS; ++i)
       {
-        // Queue is empty
-        return false;
+        pids[i] = this->owner_block->entries[i].pid.load(std::memory_order_acquire);
+        alive[i] = (pids[i] == 0) || detail::process_is_alive(pids[i]);
+        any_dead = any_dead || !alive[i];
       }
 
-      // We definitely have an item to consume
-      std::size_t pos = this->control_block->head.load(std::memory_order_relaxed);
+      if (!any_dead)
+      {
+        return 0;
+      }
 
-      *item = this->buffer[wrap(pos)].data;
+      std::size_t reclaimed = 0;
 
-      if (important != nullptr)
+      for (std::size_t i = 0; i < SQ_OWNER_SLOTS; ++i)
       {
-        *important = this->buffer[wrap(pos)].is_important.load(std::memory_order_relaxed);
+        if (alive[i])
+        {
+          continue;
+        }
+
+        Owner_Entry& entry = this->owner_block->entries[i];
+        bool pending = false;
+        std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+        std::size_t consuming = entry.consuming.load(std::memory_order_relaxed);
+        std::size_t consuming_count = entry.consuming_count.load(std::memory_order_relaxed);
+
+        // Claimed (behind head) but not handed back to producers
+        for (std::size_t pos = consuming - 1; consuming != 0 && pos != consuming - 1 + consuming_count; ++pos)
+        {
+          std::size_t published = pos + 1;
+
+          // Leased items are left to expire and be redelivered instead
+          if (static_cast<std::ptrdiff_t>(head - pos) > 0 && !this->claimed_by_live_owner(pos, alive) &&
+            !this->is_leased(this->buffer[wrap(pos)], pos) &&
+            this->buffer[wrap(pos)].sequence.compare_exchange_strong(published, pos + Capacity, std::memory_order_acq_rel))
+          {
+            ++reclaimed;
+            SQ_PROBE3(abandoned, this->control_block, pos, pids[i]);
+          }
+        }
+
+        // Reserved (before tail) but not published
+        std::size_t producing = entry.producing.load(std::memory_order_relaxed);
+        std::size_t pos = producing - 1;
+        std::size_t tail = this->control_block->tail.load(std::memory_order_acquire);
+
+        if (producing != 0 && static_cast<std::ptrdiff_t>(tail - pos) > 0 &&
+          this->buffer[wrap(pos)].sequence.load(std::memory_order_acquire) == pos &&
+          !this->claimed_by_live_owner(pos, alive))
+        {
+          std::size_t expected = pos;
+
+          if (this->control_block->head.compare_exchange_strong(expected, pos + 1, std::memory_order_acq_rel))
+          {
+            this->buffer[wrap(pos)].sequence.store(pos + Capacity, std::memory_order_release);
+            ++reclaimed;
+            SQ_PROBE3(abandoned, this->control_block, pos, pids[i]);
+          }
+          else
+          {
+            // Still behind items that have not been dequeued yet
+            pending = static_cast<std::ptrdiff_t>(pos - expected) > 0;
+          }
+        }
+
+        if (!pending)
+        {
+          entry.pid.compare_exchange_strong(pids[i], 0, std::memory_order_acq_rel);
+        }
       }
 
-      this->control_block->head.store(wrap(pos + 1), std::memory_order_release);
-      this->control_block->count.fetch_sub(1, std::memory_order_acq_rel);
+      return reclaimed;
+    }
 
-      return true;
+    // Whether this handle holds an owner entry; see feature_owners
+    bool is_registered() const
+    {
+      return (this->owner.registered() != nullptr);
+    }
+
+    // Whether this handle may enqueue and dequeue. With feature_owners, a
+    // handle that found the owner table full may not: recover_abandoned()
+    // could not tell the slots it holds from those of a dead process and
+    // would reclaim them under it. Every enqueue and dequeue of such a
+    // handle fails; recover_abandoned() still works.
+    bool is_operational() const
+    {
+      return (!owners_enabled || this->owner.registered() != nullptr);
     }
 
     // Create queue. Assume that memory pointed to by shared_memory is large enough.
-    // To allocate enough memory use; Shared_Queue<T, Capacity>::required_size().
+    // To allocate enough memory use; Shared_Queue<T, Capacity, Features>::required_size().
+    // With feature_owners, returns false if no owner entry was free; the
+    // handle is then not operational (see is_operational()). The same goes
+    // for a copy made while the table is full.
     bool create(void* shared_memory)
     {
-      // We can still perform alignment if desired
-      std::size_t alignment = alignof(std::max_align_t);
-      std::size_t aligned_control_size = (sizeof(Shared_Control_Block) + alignment - 1) & ~(alignment - 1);
-
-      // The size of the final Shared_Queue<T, Capacity> must be:
-      //   sizeof(Shared_Control_Block) + (sizeof(Buffer_Slot) * Capacity)
-
       this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
       this->buffer = reinterpret_cast<Buffer_Slot*>(
-        static_cast<char*>(shared_memory) + aligned_control_size
+        static_cast<char*>(shared_memory) + aligned_control_size()
         );
 
+      if (stats_enabled)
+      {
+        this->stats_block = reinterpret_cast<Shared_Stats_Block*>(
+          static_cast<char*>(shared_memory) + stats_offset()
+          );
+      }
+
+      if (latency_enabled)
+      {
+        this->latency_block = reinterpret_cast<Shared_Latency_Block*>(
+          static_cast<char*>(shared_memory) + latency_offset()
+          );
+      }
+
+      if (owners_enabled)
+      {
+        this->owner_block = reinterpret_cast<Shared_Owner_Block*>(
+          static_cast<char*>(shared_memory) + owners_offset()
+          );
+      }
+
       if (this->control_block->capacity != Capacity)
       {
         // Initialize control block and buffer
@@ -177,8 +1844,71 @@ namespace sq
         for (std::size_t i = 0; i < Capacity; ++i)
         {
           new (&this->buffer[i]) Buffer_Slot();
+          this->buffer[i].sequence.store(i, std::memory_order_relaxed);
           this->buffer[i].is_important.store(false, std::memory_order_relaxed);
         }
+
+        if (stats_enabled)
+        {
+          new (this->stats_block) Shared_Stats_Block();
+          this->stats_block->next_shard.store(0, std::memory_order_relaxed);
+          this->stats_block->high_water.store(0, std::memory_order_relaxed);
+
+          for (Stats_Shard& shard : this->stats_block->shards)
+          {
+            shard.enqueued.store(0, std::memory_order_relaxed);
+            shard.dequeued.store(0, std::memory_order_relaxed);
+            shard.evicted_important.store(0, std::memory_order_relaxed);
+            shard.evicted_unimportant.store(0, std::memory_order_relaxed);
+            shard.full_hits.store(0, std::memory_order_relaxed);
+            shard.empty_polls.store(0, std::memory_order_relaxed);
+
+            shard.enqueue_contention.cas_failures.store(0, std::memory_order_relaxed);
+            shard.enqueue_contention.spins.store(0, std::memory_order_relaxed);
+            shard.enqueue_contention.parks.store(0, std::memory_order_relaxed);
+            shard.dequeue_contention.cas_failures.store(0, std::memory_order_relaxed);
+            shard.dequeue_contention.spins.store(0, std::memory_order_relaxed);
+            shard.dequeue_contention.parks.store(0, std::memory_order_relaxed);
+          }
+        }
+
+        if (latency_enabled)
+        {
+          new (this->latency_block) Shared_Latency_Block();
+
+          for (std::atomic<std::uint64_t>& count : this->latency_block->counts)
+          {
+            count.store(0, std::memory_order_relaxed);
+          }
+        }
+
+        if (owners_enabled)
+        {
+          new (this->owner_block) Shared_Owner_Block();
+
+          for (Owner_Entry& entry : this->owner_block->entries)
+          {
+            entry.pid.store(0, std::memory_order_relaxed);
+            entry.producing.store(0, std::memory_order_relaxed);
+            entry.consuming.store(0, std::memory_order_relaxed);
+            entry.consuming_count.store(0, std::memory_order_relaxed);
+          }
+        }
+
+        this->describe_layout();
+      }
+
+      if (stats_enabled)
+      {
+        std::uint64_t shard = this->stats_block->next_shard.fetch_add(1, std::memory_order_relaxed);
+        this->stats_shard = &this->stats_block->shards[shard % SQ_STATS_SHARDS];
+      }
+
+      if (owners_enabled && !this->owner.attach(this->owner_block))
+      {
+        // Entries of dead processes may be holding the table
+        this->recover_abandoned();
+        return this->owner.attach(this->owner_block);
       }
 
       return true;
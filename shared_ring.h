@@ -0,0 +1,220 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_RING_H
+#define MPMC_SHARED_RING_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <new>         // For placement new
+
+namespace sq
+{
+  // Multi-stage pipeline ring (Disruptor style). A single producer claims and
+  // publishes entries, then each of the Stages stages processes them in place,
+  // in sequence order. Stage 0 waits on the producer's published sequence and
+  // stage N waits on stage N - 1. The producer is gated by the last stage, so
+  // an entry is only reused once every stage has released it.
+  //
+  // Each stage is expected to be driven by one consumer at a time:
+  //
+  //   std::size_t next = ring.position(stage);
+  //   std::size_t end = ring.available(stage);
+  //
+  //   for (std::size_t sequence = next; sequence < end; ++sequence)
+  //   {
+  //     process(ring.at(sequence));
+  //   }
+  //
+  //   ring.release(stage, end);
+  template <typename T, std::size_t Capacity, std::size_t Stages>
+  class Shared_Ring
+  {
+  private:
+    static_assert(Capacity > 0, "Capacity must be greater than zero");
+    static_assert(Stages > 0, "Stages must be greater than zero");
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    struct alignas(64) Buffer_Slot
+    {
+      T data;
+    };
+
+    // One per stage, each on its own cache line
+    struct Stage_Cursor
+    {
+      std::atomic<std::size_t> position;   // Every sequence below this is released by the stage
+      char padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+    };
+
+    struct Shared_Control_Block
+    {
+      std::atomic<std::size_t> tail;       // Every sequence below this is published
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer
+      std::size_t stage_count{ 0 };        // Number of stage cursors
+      char capacity_padding[cache_line_size - (sizeof(std::size_t) * 2)];
+      Stage_Cursor cursors[Stages];
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    Buffer_Slot* buffer{ nullptr };                 // Circular buffer slots
+
+    std::size_t claimed{ 0 };    // Producer's next sequence to claim
+    std::size_t last_cache{ 0 }; // Producer's copy of the last stage position
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity;
+    }
+
+    constexpr static std::size_t aligned_control_size()
+    {
+      return (sizeof(Shared_Control_Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+  public:
+    constexpr static std::size_t required_size()
+    {
+      return aligned_control_size() + (sizeof(Buffer_Slot) * Capacity);
+    }
+
+    // Claim the next entry for writing. Must only be called by the producer.
+    // Returns nullptr if the last stage has not released the entry yet.
+    // Claimed entries become visible to stage 0 once published.
+    T* claim(std::size_t* sequence)
+    {
+      std::size_t pos = this->claimed;
+
+      if (pos - this->last_cache >= Capacity)
+      {
+        // Looks full; refresh our view of the last stage
+        this->last_cache = this->control_block->cursors[Stages - 1].position.load(std::memory_order_acquire);
+
+        if (pos - this->last_cache >= Capacity)
+        {
+          return nullptr;
+        }
+      }
+
+      this->claimed = pos + 1;
+      *sequence = pos;
+
+      return &this->buffer[wrap(pos)].data;
+    }
+
+    // Publish every claimed entry up to and including sequence
+    void publish(std::size_t sequence)
+    {
+      this->control_block->tail.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Claim, copy and publish an item in one go
+    bool enqueue(const T& item)
+    {
+      std::size_t sequence = 0;
+      T* entry = this->claim(&sequence);
+
+      if (entry == nullptr)
+      {
+        return false;
+      }
+
+      *entry = item;
+      this->publish(sequence);
+
+      return true;
+    }
+
+    // Next sequence the given stage has to process
+    std::size_t position(std::size_t stage) const
+    {
+      return this->control_block->cursors[stage].position.load(std::memory_order_acquire);
+    }
+
+    // End (exclusive) of the sequences the given stage may process,
+    // i.e. what the producer or the previous stage has released
+    std::size_t available(std::size_t stage) const
+    {
+      if (stage == 0)
+      {
+        return this->control_block->tail.load(std::memory_order_acquire);
+      }
+
+      return this->control_block->cursors[stage - 1].position.load(std::memory_order_acquire);
+    }
+
+    // Entry for a sequence between position(stage) and available(stage)
+    T& at(std::size_t sequence)
+    {
+      return this->buffer[wrap(sequence)].data;
+    }
+
+    // Mark every sequence below end as processed by the given stage
+    void release(std::size_t stage, std::size_t end)
+    {
+      this->control_block->cursors[stage].position.store(end, std::memory_order_release);
+    }
+
+    // Count of entries published but not yet released by the last stage
+    std::size_t size() const
+    {
+      std::size_t last = this->control_block->cursors[Stages - 1].position.load(std::memory_order_acquire);
+      return this->control_block->tail.load(std::memory_order_acquire) - last;
+    }
+
+    // Check if every published entry went through all stages
+    bool is_empty() const
+    {
+      return (this->size() == 0);
+    }
+
+    // Create ring. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Ring<T, Capacity, Stages>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->buffer = reinterpret_cast<Buffer_Slot*>(
+        static_cast<char*>(shared_memory) + aligned_control_size()
+        );
+
+      if (this->control_block->capacity != Capacity ||
+          this->control_block->stage_count != Stages)
+      {
+        // Initialize control block and buffer
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->tail.store(0, std::memory_order_relaxed);
+        this->control_block->capacity = Capacity;
+        this->control_block->stage_count = Stages;
+
+        for (std::size_t i = 0; i < Stages; ++i)
+        {
+          this->control_block->cursors[i].position.store(0, std::memory_order_relaxed);
+        }
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+          new (&this->buffer[i]) Buffer_Slot();
+        }
+      }
+
+      this->claimed = this->control_block->tail.load(std::memory_order_acquire);
+      this->last_cache = this->control_block->cursors[Stages - 1].position.load(std::memory_order_acquire);
+
+      return true;
+    }
+
+    explicit Shared_Ring(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Ring() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_RING_H
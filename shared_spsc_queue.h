@@ -0,0 +1,166 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_SPSC_QUEUE_H
+#define MPMC_SHARED_SPSC_QUEUE_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <new>         // For placement new
+
+namespace sq
+{
+  // Single-Producer and Single-Consumer queue with the same shared memory
+  // attach model as Shared_Queue. Each side keeps a local copy of the other
+  // side's index and only reloads it when the queue looks full (producer)
+  // or empty (consumer), so the common path never touches a shared line.
+  template <typename T, std::size_t Capacity>
+  class Shared_Spsc_Queue
+  {
+  private:
+    static_assert(Capacity > 0, "Capacity must be greater than zero");
+
+    static constexpr std::size_t cache_line_size = 64;
+
+    // head and tail are free running counters, each on its own cache line
+    struct Shared_Control_Block
+    {
+      std::atomic<std::size_t> head;       // Consumer position
+      char head_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::atomic<std::size_t> tail;       // Producer position
+      char tail_padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+      std::size_t capacity{ 0 };           // Capacity of the buffer
+    };
+
+    // Each item on its own cache line(s), so the producer writing one item
+    // does not invalidate the line the consumer is reading the previous from
+    struct alignas(64) Buffer_Slot
+    {
+      T data;
+    };
+
+    Shared_Control_Block* control_block{ nullptr }; // Shared control block
+    Buffer_Slot* buffer{ nullptr };                 // Circular buffer slots
+
+    std::size_t head_cache{ 0 }; // Producer's copy of head
+    std::size_t tail_cache{ 0 }; // Consumer's copy of tail
+
+    std::size_t wrap(std::size_t index) const
+    {
+      return index % Capacity;
+    }
+
+    // Slots start on a cache line boundary, like the segment itself
+    constexpr static std::size_t aligned_control_size()
+    {
+      return (sizeof(Shared_Control_Block) + cache_line_size - 1) & ~(cache_line_size - 1);
+    }
+
+  public:
+    constexpr static std::size_t required_size()
+    {
+      return aligned_control_size() + (sizeof(Buffer_Slot) * Capacity);
+    }
+
+    // Check if the buffer is empty
+    bool is_empty() const
+    {
+      return (this->size() == 0);
+    }
+
+    // Count of items in the buffer
+    std::size_t size() const
+    {
+      std::size_t head = this->control_block->head.load(std::memory_order_acquire);
+      std::size_t tail = this->control_block->tail.load(std::memory_order_acquire);
+      return tail - head;
+    }
+
+    // Enqueue a new item. Must only be called by the producer.
+    // Returns false if the queue is full.
+    bool enqueue(const T& item)
+    {
+      std::size_t pos = this->control_block->tail.load(std::memory_order_relaxed);
+
+      if (pos - this->head_cache == Capacity)
+      {
+        // Looks full; refresh our view of the consumer position
+        this->head_cache = this->control_block->head.load(std::memory_order_acquire);
+
+        if (pos - this->head_cache == Capacity)
+        {
+          return false;
+        }
+      }
+
+      this->buffer[wrap(pos)].data = item;
+      this->control_block->tail.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Dequeue an item. Must only be called by the consumer.
+    // Returns false if the queue is empty.
+    bool dequeue(T* item)
+    {
+      std::size_t pos = this->control_block->head.load(std::memory_order_relaxed);
+
+      if (pos == this->tail_cache)
+      {
+        // Looks empty; refresh our view of the producer position
+        this->tail_cache = this->control_block->tail.load(std::memory_order_acquire);
+
+        if (pos == this->tail_cache)
+        {
+          return false;
+        }
+      }
+
+      *item = this->buffer[wrap(pos)].data;
+      this->control_block->head.store(pos + 1, std::memory_order_release);
+
+      return true;
+    }
+
+    // Create queue. Assume that memory pointed to by shared_memory is large enough.
+    // To allocate enough memory use; Shared_Spsc_Queue<T, Capacity>::required_size().
+    bool create(void* shared_memory)
+    {
+      this->control_block = static_cast<Shared_Control_Block*>(shared_memory);
+      this->buffer = reinterpret_cast<Buffer_Slot*>(
+        static_cast<char*>(shared_memory) + aligned_control_size()
+        );
+
+      if (this->control_block->capacity != Capacity)
+      {
+        // Initialize control block and buffer
+        new (this->control_block) Shared_Control_Block();
+        this->control_block->head.store(0, std::memory_order_relaxed);
+        this->control_block->tail.store(0, std::memory_order_relaxed);
+        this->control_block->capacity = Capacity;
+
+        for (std::size_t i = 0; i < Capacity; ++i)
+        {
+          new (&this->buffer[i]) Buffer_Slot();
+        }
+      }
+
+      this->head_cache = this->control_block->head.load(std::memory_order_acquire);
+      this->tail_cache = this->control_block->tail.load(std::memory_order_acquire);
+
+      return true;
+    }
+
+    explicit Shared_Spsc_Queue(void* shared_memory)
+    {
+      this->create(shared_memory);
+    }
+
+    // Default constructor
+    Shared_Spsc_Queue() = default;
+  };
+} // namespace sq
+
+#endif // MPMC_SHARED_SPSC_QUEUE_H
@@ -0,0 +1,76 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_SHARED_TRACE_H
+#define MPMC_SHARED_TRACE_H
+
+// Static tracepoints (USDT) for the queues, under the provider "sq".
+//
+// Define SQ_ENABLE_USDT before including any queue header to compile them
+// in. Each probe is then a nop in the instruction stream plus an ELF note
+// describing its arguments, which a tracer such as perf, bpftrace or
+// SystemTap can attach to:
+//
+//   bpftrace -e 'usdt:./app:sq:overflow { @[arg2] = count(); }'
+//
+// The probes use USDT semaphores: a tracer increments sq_<probe>_semaphore
+// while attached, and until then a probe is a load and a not-taken branch
+// that skips evaluating its arguments. This defines _SDT_HAS_SEMAPHORES for
+// <sys/sdt.h>, so other probes in the same source file need semaphores too.
+// Define SQ_USDT_NO_SEMAPHORES, or include <sys/sdt.h> first, to always
+// evaluate the arguments instead.
+//
+// Without SQ_ENABLE_USDT, or where <sys/sdt.h> is not available (install
+// systemtap-sdt-dev / systemtap-sdt-devel), the probes expand to nothing.
+
+#if defined(SQ_ENABLE_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#if !defined(_SYS_SDT_H) && !defined(_SDT_HAS_SEMAPHORES) && !defined(SQ_USDT_NO_SEMAPHORES)
+#define _SDT_HAS_SEMAPHORES 1
+#endif
+#include <sys/sdt.h>   // For DTRACE_PROBE1, DTRACE_PROBE3
+#define SQ_USDT_AVAILABLE 1
+#if defined(_SDT_HAS_SEMAPHORES)
+#define SQ_USDT_SEMAPHORES 1
+#endif
+#endif
+#endif
+
+#if defined(SQ_USDT_SEMAPHORES)
+// Weak, so every source file including this can define them; hidden, so each
+// executable or shared library has its own, matching its own probe notes
+#define SQ_PROBE_SEMAPHORE(name) \
+  __extension__ volatile unsigned short sq_##name##_semaphore \
+    __attribute__((weak, unused, visibility("hidden"), section(".probes")))
+
+SQ_PROBE_SEMAPHORE(enqueue);
+SQ_PROBE_SEMAPHORE(dequeue);
+SQ_PROBE_SEMAPHORE(dequeue_bulk);
+SQ_PROBE_SEMAPHORE(overflow);
+SQ_PROBE_SEMAPHORE(empty);
+SQ_PROBE_SEMAPHORE(abandoned);
+SQ_PROBE_SEMAPHORE(redelivered);
+SQ_PROBE_SEMAPHORE(expired);
+SQ_PROBE_SEMAPHORE(block);
+SQ_PROBE_SEMAPHORE(wake);
+
+// Whether a tracer is attached to the probe
+#define SQ_PROBE_ENABLED(name) __builtin_expect(sq_##name##_semaphore != 0, 0)
+#elif defined(SQ_USDT_AVAILABLE)
+#define SQ_PROBE_ENABLED(name) 1
+#else
+#define SQ_PROBE_ENABLED(name) 0
+#endif
+
+#if defined(SQ_USDT_AVAILABLE)
+#define SQ_PROBE1(name, a) do { if (SQ_PROBE_ENABLED(name)) { DTRACE_PROBE1(sq, name, a); } } while (0)
+#define SQ_PROBE3(name, a, b, c) do { if (SQ_PROBE_ENABLED(name)) { DTRACE_PROBE3(sq, name, a, b, c); } } while (0)
+#else
+// sizeof keeps the arguments unevaluated but still counts them as used
+#define SQ_PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define SQ_PROBE3(name, a, b, c) do { (void)sizeof(a); (void)sizeof(b); (void)sizeof(c); } while (0)
+#endif
+
+#endif // MPMC_SHARED_TRACE_H
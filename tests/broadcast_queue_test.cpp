@@ -0,0 +1,154 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Broadcast_Queue. With enqueue(), every consumer
+// must see every item exactly once and in order. With enqueue_overwrite(),
+// consumers may fall behind, but what they read must be intact and in
+// order, and what they missed must be reported as lost.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. broadcast_queue_test.cpp -lpthread -o broadcast_queue_test
+
+#include <atomic>      // For std::atomic
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+
+#include "../shared_broadcast_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t consumers = 3;
+  constexpr std::uint64_t items = 300000;
+
+  // Large enough that a torn read shows up as a mismatch
+  struct Item
+  {
+    std::uint64_t value;
+    std::uint64_t words[6];
+  };
+
+  typedef sq::Shared_Broadcast_Queue<Item, 32, consumers> Queue;
+
+  Item make_item(std::uint64_t value)
+  {
+    Item item;
+    item.value = value;
+
+    for (std::uint64_t i = 0; i < 6; ++i)
+    {
+      item.words[i] = value * 7 + i;
+    }
+
+    return item;
+  }
+
+  bool is_intact(const Item& item)
+  {
+    for (std::uint64_t i = 0; i < 6; ++i)
+    {
+      if (item.words[i] != item.value * 7 + i)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Run the producer and consumers; overwrite selects enqueue_overwrite()
+  void run(bool overwrite)
+  {
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    std::size_t cursors[consumers];
+
+    for (std::size_t i = 0; i < consumers; ++i)
+    {
+      SQ_CHECK(queue.subscribe(&cursors[i]));
+    }
+
+    std::size_t extra = 0;
+    SQ_CHECK(!queue.subscribe(&extra));
+
+    std::atomic<bool> done{ false };
+    std::atomic<std::size_t> failures{ 0 };
+    std::uint64_t received[consumers] = {};
+    std::uint64_t lost[consumers] = {};
+
+    sq_test::run_threads(consumers + 1, [&](std::size_t index)
+    {
+      if (index == consumers)
+      {
+        for (std::uint64_t i = 0; i < items; ++i)
+        {
+          if (overwrite)
+          {
+            queue.enqueue_overwrite(make_item(i));
+            continue;
+          }
+
+          while (!queue.enqueue(make_item(i)))
+          {
+            std::this_thread::yield();
+          }
+        }
+
+        done.store(true, std::memory_order_release);
+        return;
+      }
+
+      std::size_t cursor = cursors[index];
+      std::uint64_t next = 0;
+      Item item;
+
+      while (true)
+      {
+        std::size_t skipped = 0;
+        bool success = queue.dequeue(cursor, &item, &skipped);
+
+        lost[index] += skipped;
+        next += skipped;
+
+        if (!success)
+        {
+          if (done.load(std::memory_order_acquire) && queue.is_empty(cursor))
+          {
+            break;
+          }
+
+          std::this_thread::yield();
+          continue;
+        }
+
+        if (item.value != next || !is_intact(item))
+        {
+          failures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        next = item.value + 1;
+        ++received[index];
+      }
+    });
+
+    SQ_CHECK(failures.load() == 0);
+
+    for (std::size_t i = 0; i < consumers; ++i)
+    {
+      SQ_CHECK(received[i] + lost[i] == items);
+      SQ_CHECK(overwrite || lost[i] == 0);
+    }
+  }
+}
+
+int main()
+{
+  run(false);
+  run(true);
+
+  std::printf("broadcast_queue_test: %llu items to %llu consumers ok\n",
+    static_cast<unsigned long long>(items), static_cast<unsigned long long>(consumers));
+  return 0;
+}
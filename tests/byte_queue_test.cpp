@@ -0,0 +1,114 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Byte_Queue: several producers and consumers
+// move variable-length messages through a small ring that wraps constantly.
+// Every message must arrive exactly once and intact.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. byte_queue_test.cpp -lpthread -o byte_queue_test
+
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstring>     // For std::memcpy
+
+#include "../shared_byte_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t producers = 4;
+  constexpr std::size_t consumers = 4;
+  constexpr std::uint64_t per_producer = 200000;
+  constexpr std::size_t max_payload = 40;
+
+  typedef sq::Shared_Byte_Queue<512> Queue;
+
+  // Message of value: the value, then a length and fill derived from it
+  std::size_t message_size(std::uint64_t value)
+  {
+    return sizeof(value) + static_cast<std::size_t>(value % (max_payload - sizeof(value) + 1));
+  }
+
+  unsigned char fill_byte(std::uint64_t value, std::size_t i)
+  {
+    return static_cast<unsigned char>(value * 31 + i);
+  }
+}
+
+int main()
+{
+  sq_test::Test_Memory memory(Queue::required_size());
+  Queue queue(memory.data());
+
+  // Messages that do not fit at all are refused
+  static_assert(Queue::max_message_size() >= max_payload, "ring too small for the test messages");
+  unsigned char large[Queue::max_message_size() + 1] = {};
+  SQ_CHECK(!queue.enqueue(large, sizeof(large)));
+
+  sq_test::Delivery_Log log(producers * per_producer);
+  std::atomic<std::uint64_t> received{ 0 };
+  std::atomic<std::uint64_t> corrupt{ 0 };
+
+  sq_test::run_threads(producers + consumers, [&](std::size_t index)
+  {
+    if (index < producers)
+    {
+      unsigned char message[max_payload];
+
+      for (std::uint64_t i = 0; i < per_producer; ++i)
+      {
+        std::uint64_t value = index * per_producer + i;
+        std::size_t size = message_size(value);
+
+        std::memcpy(message, &value, sizeof(value));
+
+        for (std::size_t b = sizeof(value); b < size; ++b)
+        {
+          message[b] = fill_byte(value, b);
+        }
+
+        while (!queue.enqueue(message, size))
+        {
+          std::this_thread::yield();
+        }
+      }
+
+      return;
+    }
+
+    unsigned char message[max_payload];
+    std::size_t size = 0;
+
+    while (received.load(std::memory_order_relaxed) < producers * per_producer)
+    {
+      if (!queue.dequeue(message, sizeof(message), &size))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      std::uint64_t value = 0;
+      std::memcpy(&value, message, sizeof(value));
+      bool intact = (size == message_size(value));
+
+      for (std::size_t b = sizeof(value); intact && b < size; ++b)
+      {
+        intact = (message[b] == fill_byte(value, b));
+      }
+
+      corrupt.fetch_add(intact ? 0 : 1, std::memory_order_relaxed);
+      log.deliver(value);
+      received.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+
+  SQ_CHECK(corrupt.load() == 0);
+  SQ_CHECK(log.complete());
+  SQ_CHECK(queue.is_empty() && queue.size() == 0);
+
+  std::printf("byte_queue_test: %llu messages ok\n", static_cast<unsigned long long>(producers * per_producer));
+  return 0;
+}
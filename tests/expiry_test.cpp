@@ -0,0 +1,204 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Item expiry of sq::Shared_Queue with feature_ttl.
+//
+//   dequeue   dequeue(), dequeue_bulk() and lease() skip expired items and
+//             count them, wherever they sit in a batch.
+//   overflow  A full enqueue discards expired items before any live one.
+//   stress    Producers mix items without a TTL, with a long one and with
+//             one that has practically passed already. Every live item
+//             arrives exactly once, and every item is either dequeued or
+//             counted as expired.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. expiry_test.cpp -lpthread -o expiry_test
+
+#include <atomic>      // For std::atomic
+#include <chrono>      // For std::chrono::milliseconds
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <thread>      // For std::this_thread::sleep_for
+
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::uint64_t short_ttl = 1000;           // 1 us; gone by the next sleep
+  constexpr std::uint64_t long_ttl = 60000000000ull;  // 1 min; outlives the test
+
+  void pause()
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+  void run_dequeue()
+  {
+    typedef sq::Shared_Queue<int, 8, sq::feature_ttl | sq::feature_stats | sq::feature_leases> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    int items[8];
+    int item = 0;
+
+    SQ_CHECK(queue.enqueue_with_ttl(1, short_ttl) && queue.enqueue(2) && queue.enqueue_with_ttl(3, long_ttl));
+    pause();
+    SQ_CHECK(queue.dequeue(&item) && item == 2);
+    SQ_CHECK(queue.dequeue(&item) && item == 3);
+    SQ_CHECK(!queue.dequeue(&item) && queue.stats().expired == 1);
+
+    // Expired items at the front, in the middle and at the end of a batch
+    queue.enqueue_with_ttl(10, short_ttl);
+    queue.enqueue_with_ttl(11, short_ttl);
+    queue.enqueue(12);
+    queue.enqueue_with_ttl(13, short_ttl);
+    queue.enqueue(14);
+    queue.enqueue_with_ttl(15, short_ttl);
+    pause();
+    SQ_CHECK(queue.dequeue_bulk(items, 8) == 2 && items[0] == 12 && items[1] == 14);
+    SQ_CHECK(queue.stats().expired == 5 && queue.is_empty());
+
+    // A batch whose first claim is all expired carries on to live items
+    queue.enqueue_with_ttl(20, short_ttl);
+    queue.enqueue_with_ttl(21, short_ttl);
+    pause();
+    queue.enqueue(22);
+    SQ_CHECK(queue.dequeue_bulk(items, 2) == 1 && items[0] == 22);
+    SQ_CHECK(queue.stats().expired == 7 && queue.is_empty());
+
+    // lease() skips expired items too
+    sq::Queue_Lease lease;
+    queue.enqueue_with_ttl(30, short_ttl);
+    queue.enqueue(31);
+    pause();
+    SQ_CHECK(queue.lease(&item, &lease, long_ttl) && item == 31 && queue.ack(lease));
+    SQ_CHECK(queue.stats().expired == 8 && queue.is_empty());
+  }
+
+  void run_overflow()
+  {
+    typedef sq::Shared_Queue<int, 8, sq::feature_ttl | sq::feature_stats> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    int item = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+      queue.enqueue_with_ttl(30 + i, short_ttl);
+    }
+
+    pause();
+
+    for (int i = 0; i < 5; ++i)
+    {
+      queue.enqueue(40 + i);
+    }
+
+    // The queue is full; the first enqueue drops all three expired items
+    SQ_CHECK(queue.enqueue(50) && queue.enqueue(51));
+
+    sq::Queue_Stats stats = queue.stats();
+    SQ_CHECK(stats.expired == 3 && stats.evicted_important + stats.evicted_unimportant == 0 && queue.size() == 7);
+
+    for (int i = 0; i < 5; ++i)
+    {
+      SQ_CHECK(queue.dequeue(&item) && item == 40 + i);
+    }
+
+    SQ_CHECK(queue.dequeue(&item) && item == 50);
+    SQ_CHECK(queue.dequeue(&item) && item == 51);
+  }
+
+  void run_stress()
+  {
+    typedef sq::Shared_Queue<std::uint64_t, 64, sq::feature_ttl | sq::feature_stats> Queue;
+
+    constexpr std::size_t producers = 3;
+    constexpr std::size_t consumers = 3;
+    constexpr std::uint64_t per_producer = 100000;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    sq_test::Delivery_Log log(producers * per_producer);
+    std::atomic<std::size_t> producers_done{ 0 };
+
+    sq_test::run_threads(producers + consumers, [&](std::size_t index)
+    {
+      if (index < producers)
+      {
+        for (std::uint64_t i = 0; i < per_producer; ++i)
+        {
+          std::uint64_t value = index * per_producer + i;
+
+          // Never full, so nothing is evicted
+          while (queue.size() > 32)
+          {
+            std::this_thread::yield();
+          }
+
+          if (value % 3 == 0)
+          {
+            queue.enqueue(value);
+          }
+          else
+          {
+            queue.enqueue_with_ttl(value, (value % 3 == 1) ? 1 : long_ttl);
+          }
+        }
+
+        producers_done.fetch_add(1, std::memory_order_release);
+        return;
+      }
+
+      std::uint64_t items[8];
+
+      while (true)
+      {
+        std::size_t count = (index % 2 == 0) ? queue.dequeue_bulk(items, 8) : (queue.dequeue(items) ? 1 : 0);
+
+        if (count == 0)
+        {
+          if (producers_done.load(std::memory_order_acquire) == producers && queue.is_empty())
+          {
+            break;
+          }
+
+          std::this_thread::yield();
+          continue;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          log.deliver(items[i]);
+        }
+      }
+    });
+
+    sq::Queue_Stats stats = queue.stats();
+
+    SQ_CHECK(log.unique());
+    SQ_CHECK(stats.enqueued == producers * per_producer);
+    SQ_CHECK(stats.evicted_important + stats.evicted_unimportant == 0);
+    SQ_CHECK(stats.enqueued == stats.dequeued + stats.expired);
+    SQ_CHECK(log.missing() == stats.expired);
+
+    for (std::uint64_t value = 0; value < producers * per_producer; ++value)
+    {
+      SQ_CHECK(value % 3 == 1 || log.received(value));
+    }
+  }
+}
+
+int main()
+{
+  run_dequeue();
+  run_overflow();
+  run_stress();
+
+  std::printf("expiry_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,138 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Gather kernels behind sq::Shared_Queue::dequeue_bulk(). Runs of every
+// length, starting at every slot so they cross the wrap point, are taken
+// for items of 8, 16, 24 and 32 bytes, once with each kernel this CPU
+// supports (scalar, AVX2, AVX-512). Every byte of every item must arrive,
+// and nothing past the last item taken may be written.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. gather_test.cpp -o gather_test
+
+#include <cstdint>     // For std::uint32_t, std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstring>     // For std::memset
+
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t capacity = 16;
+  constexpr unsigned char untouched = 0xEE;
+
+  template <std::size_t Size>
+  struct Record
+  {
+    unsigned char bytes[Size];
+  };
+
+  unsigned char fill_byte(std::uint64_t id, std::size_t i)
+  {
+    return static_cast<unsigned char>((id * 31) + (i * 7) + 1);
+  }
+
+  template <std::size_t Size, std::uint32_t Features>
+  void run_wrap()
+  {
+    typedef sq::Shared_Queue<Record<Size>, capacity, Features> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    Record<Size> item;
+    Record<Size> out[capacity + 1];
+    std::uint64_t next_id = 0;
+
+    // Move the start through every slot with every run length
+    for (std::size_t lap = 0; lap < capacity * capacity; ++lap)
+    {
+      std::size_t count = 1 + (lap % capacity);
+      std::uint64_t first_id = next_id;
+
+      for (std::size_t n = 0; n < count; ++n, ++next_id)
+      {
+        for (std::size_t i = 0; i < Size; ++i)
+        {
+          item.bytes[i] = fill_byte(next_id, i);
+        }
+
+        SQ_CHECK(queue.enqueue(item));
+      }
+
+      std::size_t taken = 0;
+
+      while (taken < count)
+      {
+        std::memset(out, untouched, sizeof(out));
+        std::size_t kept = queue.dequeue_bulk(out, count - taken);
+        SQ_CHECK(kept != 0 && kept <= count - taken);
+
+        for (std::size_t n = 0; n < kept; ++n)
+        {
+          for (std::size_t i = 0; i < Size; ++i)
+          {
+            SQ_CHECK(out[n].bytes[i] == fill_byte(first_id + taken + n, i));
+          }
+        }
+
+        for (std::size_t i = 0; i < Size; ++i)
+        {
+          SQ_CHECK(out[kept].bytes[i] == untouched);
+        }
+
+        taken += kept;
+      }
+
+      SQ_CHECK(queue.is_empty());
+    }
+  }
+
+  template <std::uint32_t Features>
+  void run_sizes()
+  {
+    run_wrap<8, Features>();
+    run_wrap<16, Features>();
+    run_wrap<24, Features>();
+    run_wrap<32, Features>();
+  }
+
+  void run_kernel(const char* name, sq::detail::Gather_Copy kernel)
+  {
+    sq::detail::override_gather_copy(kernel);
+
+    // Two slot layouts, so the item sits at different offsets in its slot
+    run_sizes<sq::feature_none>();
+    run_sizes<sq::feature_latency | sq::feature_ttl>();
+
+    std::printf(" %s", name);
+  }
+}
+
+int main()
+{
+  std::printf("gather_test:");
+
+  run_kernel("scalar", sq::detail::gather_copy_scalar);
+
+#if defined(SQ_HAS_X86_DISPATCH)
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+  {
+    run_kernel("avx2", sq::detail::gather_copy_avx2);
+  }
+
+  if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl"))
+  {
+    run_kernel("avx512", sq::detail::gather_copy_avx512);
+  }
+#endif
+
+  sq::detail::override_gather_copy(nullptr);
+
+  std::printf(" ok\n");
+  return 0;
+}
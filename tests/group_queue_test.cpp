@@ -0,0 +1,115 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Group_Queue: two groups of three workers join
+// concurrently and share the items of one producer. Every group must
+// receive every item exactly once, spread over its workers.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. group_queue_test.cpp -lpthread -o group_queue_test
+
+#include <atomic>      // For std::atomic
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+
+#include "../shared_group_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t groups = 2;
+  constexpr std::size_t workers = 3;
+  constexpr std::uint64_t items = 300000;
+
+  typedef sq::Shared_Group_Queue<std::uint64_t, 64, groups, workers> Queue;
+}
+
+int main()
+{
+  sq_test::Test_Memory memory(Queue::required_size());
+  Queue queue(memory.data());
+
+  sq_test::Delivery_Log first_log(items);
+  sq_test::Delivery_Log second_log(items);
+  sq_test::Delivery_Log* group_logs[groups] = { &first_log, &second_log };
+  std::atomic<std::uint64_t> received[groups];
+  std::atomic<std::size_t> joined{ 0 };
+  std::atomic<std::size_t> failures{ 0 };
+
+  for (std::size_t i = 0; i < groups; ++i)
+  {
+    received[i].store(0);
+  }
+
+  sq_test::run_threads(groups * workers + 1, [&](std::size_t index)
+  {
+    if (index == groups * workers)
+    {
+      // Items enqueued before a group is active are not delivered to it
+      while (joined.load() != groups * workers)
+      {
+        std::this_thread::yield();
+      }
+
+      for (std::uint64_t i = 0; i < items; ++i)
+      {
+        while (!queue.enqueue(i))
+        {
+          std::this_thread::yield();
+        }
+      }
+
+      return;
+    }
+
+    std::size_t group = index / workers;
+    std::size_t worker = 0;
+
+    if (!queue.join(group, &worker))
+    {
+      failures.fetch_add(1);
+    }
+
+    joined.fetch_add(1);
+
+    std::uint64_t item = 0;
+
+    while (received[group].load(std::memory_order_relaxed) < items)
+    {
+      if (!queue.dequeue(group, worker, &item))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      group_logs[group]->deliver(item);
+      received[group].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    queue.leave(group, worker);
+  });
+
+  SQ_CHECK(failures.load() == 0);
+
+  for (std::size_t i = 0; i < groups; ++i)
+  {
+    SQ_CHECK(group_logs[i]->complete());
+    SQ_CHECK(queue.is_empty(i));
+  }
+
+  // A full group refuses another worker
+  std::size_t worker[workers + 1];
+
+  for (std::size_t i = 0; i < workers; ++i)
+  {
+    SQ_CHECK(queue.join(0, &worker[i]));
+  }
+
+  SQ_CHECK(!queue.join(0, &worker[workers]));
+
+  std::printf("group_queue_test: %llu items to %llu groups ok\n",
+    static_cast<unsigned long long>(items), static_cast<unsigned long long>(groups));
+  return 0;
+}
@@ -0,0 +1,220 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Crash recovery of sq::Journal_Writer and the readers.
+//
+//   torn     A journal whose last record is cut short or damaged is read up
+//            to the last complete record, and reopening it for appending
+//            drops the damage and continues the numbering.
+//   killed   A process is SIGKILLed while appending. The journal reads as a
+//            gap-free prefix, and the next writer continues after it.
+//   drain    drain() moves every item from a queue to the journal and on to
+//            a mirror queue in order, and takes nothing while the journal
+//            is closed.
+//
+// Build (POSIX only):
+//   g++ -std=c++11 -O2 -I.. journal_test.cpp -lpthread -o journal_test
+
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <string>      // For std::string, std::to_string
+
+#include <fcntl.h>     // For open
+#include <signal.h>    // For kill, SIGKILL
+#include <sys/wait.h>  // For waitpid
+#include <unistd.h>    // For fork, truncate, unlink
+
+#include "../shared_journal.h"
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  typedef sq::Journal_Writer<std::uint64_t> Writer;
+  typedef sq::Journal_Reader<std::uint64_t> Reader;
+
+  constexpr off_t record_size = sizeof(sq::Journal_Record) + sizeof(std::uint64_t);
+
+  // Read the whole journal; every record must carry its own number as item
+  std::uint64_t read_prefix(const std::string& path)
+  {
+    Reader reader;
+    std::uint64_t item = 0;
+    std::uint64_t sequence = 0;
+    std::uint64_t count = 0;
+
+    SQ_CHECK(reader.open(path.c_str()));
+
+    while (reader.next(&item, nullptr, &sequence))
+    {
+      SQ_CHECK(sequence == count && item == count);
+      ++count;
+    }
+
+    return count;
+  }
+
+  void write_records(const std::string& path, std::uint64_t count)
+  {
+    Writer writer;
+    SQ_CHECK(writer.open(path.c_str()));
+
+    for (std::uint64_t i = writer.next_sequence(), end = i + count; i < end; ++i)
+    {
+      SQ_CHECK(writer.append(i, i % 3 == 0));
+    }
+
+    writer.close();
+  }
+
+  void run_torn(const std::string& path)
+  {
+    unlink(path.c_str());
+    write_records(path, 100);
+    SQ_CHECK(read_prefix(path) == 100);
+
+    // Cut the last record short
+    off_t end = static_cast<off_t>(sq::journal_block_size) + 100 * record_size;
+    SQ_CHECK(truncate(path.c_str(), end - 10) == 0);
+    SQ_CHECK(read_prefix(path) == 99);
+
+    // Damage the new last record
+    int fd = ::open(path.c_str(), O_RDWR);
+    SQ_CHECK(fd >= 0);
+    SQ_CHECK(pwrite(fd, "\xff", 1, end - 2 * record_size + 20) == 1);
+    close(fd);
+
+    Reader reader;
+    std::uint64_t item = 0;
+    std::uint64_t count = 0;
+
+    SQ_CHECK(reader.open(path.c_str()));
+
+    while (reader.next(&item))
+    {
+      ++count;
+    }
+
+    SQ_CHECK(count == 98 && reader.is_corrupt());
+    reader.close();
+
+    // The writer drops both and numbers on from 98
+    Writer writer;
+    SQ_CHECK(writer.open(path.c_str()) && writer.next_sequence() == 98);
+    writer.close();
+
+    write_records(path, 10);
+    SQ_CHECK(read_prefix(path) == 108);
+
+    // Replay skips what a consumer already has
+    sq_test::Test_Memory memory(sq::Shared_Queue<std::uint64_t, 128>::required_size());
+    sq::Shared_Queue<std::uint64_t, 128> queue(memory.data());
+
+    SQ_CHECK(sq::replay_journal<std::uint64_t>(path.c_str(), queue, 50) == 58);
+    SQ_CHECK(queue.dequeue(&item) && item == 50 && queue.size() == 57);
+  }
+
+  void run_killed(const std::string& path)
+  {
+    for (int round = 0; round < 5; ++round)
+    {
+      unlink(path.c_str());
+
+      pid_t child = fork();
+
+      if (child == 0)
+      {
+        // Append a counting sequence until killed, in small writes
+        sq::Journal_Options options;
+        options.buffer_size = sq::journal_block_size;
+
+        Writer writer;
+
+        if (!writer.open(path.c_str(), options))
+        {
+          _exit(1);
+        }
+
+        for (std::uint64_t i = 0; ; ++i)
+        {
+          writer.append(i);
+        }
+      }
+
+      usleep(5000 + round * 2000);
+      kill(child, SIGKILL);
+      waitpid(child, nullptr, 0);
+
+      std::uint64_t count = read_prefix(path);
+
+      // The next writer continues exactly after what survived
+      Writer writer;
+      SQ_CHECK(writer.open(path.c_str()) && writer.next_sequence() == count);
+      writer.close();
+
+      write_records(path, 5);
+      SQ_CHECK(read_prefix(path) == count + 5);
+    }
+  }
+
+  void run_drain(const std::string& path)
+  {
+    typedef sq::Shared_Queue<std::uint64_t, 256> Queue;
+
+    unlink(path.c_str());
+
+    sq_test::Test_Memory source_memory(Queue::required_size());
+    sq_test::Test_Memory mirror_memory(Queue::required_size());
+    Queue source(source_memory.data());
+    Queue mirror(mirror_memory.data());
+    Writer writer;
+    std::size_t moved = 0;
+    std::uint64_t item = 0;
+
+    SQ_CHECK(writer.open(path.c_str()));
+
+    for (std::uint64_t i = 0; i < 200; ++i)
+    {
+      SQ_CHECK(source.enqueue(i));
+    }
+
+    SQ_CHECK(writer.drain(source, &mirror, &moved) && moved == sq::journal_drain_batch);
+    writer.close();
+
+    // Closed: nothing is taken from the source
+    SQ_CHECK(!writer.drain(source, &mirror, &moved) && moved == 0);
+    SQ_CHECK(source.size() == 200 - sq::journal_drain_batch);
+
+    SQ_CHECK(writer.open(path.c_str()));
+
+    while (writer.drain(source, &mirror, &moved) && moved != 0)
+    {
+    }
+
+    writer.close();
+
+    SQ_CHECK(source.is_empty() && writer.forward_dropped() == 0);
+    SQ_CHECK(read_prefix(path) == 200);
+
+    for (std::uint64_t i = 0; i < 200; ++i)
+    {
+      SQ_CHECK(mirror.dequeue(&item) && item == i);
+    }
+  }
+}
+
+int main()
+{
+  std::string path = "/tmp/journal_test_" + std::to_string(getpid()) + ".sqj";
+
+  run_torn(path);
+  run_killed(path);
+  run_drain(path);
+
+  unlink(path.c_str());
+
+  std::printf("journal_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,139 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Bucket math of sq::Basic_Latency_Histogram, for the 3 sub-bucket bits of
+// Latency_Histogram and the 10 the benchmarks use.
+//
+//   buckets     Values below 2 << bits have a bucket each. Above that the
+//               buckets cover every value once, in order, up to UINT64_MAX.
+//   error       A bucket's highest value exceeds any value in it by at most
+//               2^-bits of that value, at every power-of-two edge.
+//   percentile  Percentiles of 1..1000 are exact where the buckets are and
+//               within the bucket error elsewhere.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. latency_histogram_test.cpp -o latency_histogram_test
+
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <limits>      // For std::numeric_limits
+#include <memory>      // For std::unique_ptr
+
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::uint64_t max_value = std::numeric_limits<std::uint64_t>::max();
+
+  template <unsigned Bits>
+  void run_buckets()
+  {
+    typedef sq::Basic_Latency_Histogram<Bits> Histogram;
+
+    constexpr std::uint64_t exact_limit = std::uint64_t(2) << Bits;
+
+    for (std::uint64_t value = 0; value < exact_limit; ++value)
+    {
+      SQ_CHECK(Histogram::bucket_of(value) == value && Histogram::highest_value(value) == value);
+    }
+
+    // Each bucket starts right after the previous one ends
+    for (std::size_t bucket = 1; bucket < Histogram::bucket_count; ++bucket)
+    {
+      std::uint64_t lowest = Histogram::highest_value(bucket - 1) + 1;
+      std::uint64_t highest = Histogram::highest_value(bucket);
+
+      SQ_CHECK(lowest <= highest);
+      SQ_CHECK(Histogram::bucket_of(lowest) == bucket && Histogram::bucket_of(highest) == bucket);
+    }
+
+    SQ_CHECK(Histogram::bucket_of(max_value) == Histogram::bucket_count - 1);
+    SQ_CHECK(Histogram::highest_value(Histogram::bucket_count - 1) == max_value);
+  }
+
+  template <unsigned Bits>
+  void check_error(std::uint64_t value)
+  {
+    typedef sq::Basic_Latency_Histogram<Bits> Histogram;
+
+    std::uint64_t highest = Histogram::highest_value(Histogram::bucket_of(value));
+
+    SQ_CHECK(highest >= value && highest - value <= (value >> Bits));
+
+    if (value < (std::uint64_t(2) << Bits))
+    {
+      SQ_CHECK(highest == value);
+    }
+  }
+
+  template <unsigned Bits>
+  void run_error()
+  {
+    for (unsigned bit = 1; bit < 64; ++bit)
+    {
+      std::uint64_t edge = std::uint64_t(1) << bit;
+
+      check_error<Bits>(edge - 1);
+      check_error<Bits>(edge);
+      check_error<Bits>(edge + 1);
+      check_error<Bits>(edge + (edge >> 1));
+    }
+
+    check_error<Bits>(max_value);
+    check_error<Bits>(max_value - 1);
+  }
+
+  template <unsigned Bits>
+  void run_percentile()
+  {
+    typedef sq::Basic_Latency_Histogram<Bits> Histogram;
+
+    std::unique_ptr<Histogram> histogram(new Histogram());
+    SQ_CHECK(histogram->total() == 0 && histogram->percentile(50.0) == 0);
+
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+    {
+      ++histogram->counts[Histogram::bucket_of(value)];
+    }
+
+    SQ_CHECK(histogram->total() == 1000);
+
+    // The exact percentile of 1..1000 is 10 * percent
+    const double percents[] = { 0.0, 1.0, 25.0, 50.0, 90.0, 99.0, 99.9, 100.0 };
+
+    for (double percent : percents)
+    {
+      std::uint64_t exact = static_cast<std::uint64_t>((percent * 10.0) + 0.5);
+      exact = (exact == 0) ? 1 : exact;
+      std::uint64_t reported = histogram->percentile(percent);
+
+      SQ_CHECK(reported == Histogram::highest_value(Histogram::bucket_of(exact)));
+      SQ_CHECK(reported >= exact && reported - exact <= (exact >> Bits));
+
+      if (exact < (std::uint64_t(2) << Bits))
+      {
+        SQ_CHECK(reported == exact);
+      }
+    }
+  }
+
+  template <unsigned Bits>
+  void run_all()
+  {
+    run_buckets<Bits>();
+    run_error<Bits>();
+    run_percentile<Bits>();
+  }
+}
+
+int main()
+{
+  run_all<3>();
+  run_all<10>();
+
+  std::printf("latency_histogram_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,320 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Leases of sq::Shared_Queue with feature_leases.
+//
+//   expiry   An unacknowledged lease is redelivered once it expires, and
+//            its ack() fails from then on.
+//   full     A full queue of expired leases takes new items without the
+//            redelivery recursing into itself.
+//   recover  recover() puts leased, unacknowledged items back in front of
+//            the queue in their original order, wherever the ring wraps.
+//   shared   Threads sharing one handle lease, skip some acks and see
+//            those items again. Every item is acknowledged exactly once.
+//   killed   Consumer processes are killed while holding leases. Every
+//            item is still acknowledged exactly once.
+//
+// Build (POSIX only):
+//   g++ -std=c++11 -O2 -I.. leases_test.cpp -lpthread -o leases_test
+
+#include <atomic>      // For std::atomic
+#include <chrono>      // For std::chrono::milliseconds
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstring>     // For std::memset
+#include <memory>      // For std::unique_ptr
+#include <thread>      // For std::this_thread::sleep_for
+#include <vector>      // For std::vector
+
+#include <signal.h>    // For kill, sigprocmask
+#include <sys/wait.h>  // For waitpid
+#include <unistd.h>    // For fork
+
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::uint64_t second_ns = 1000000000;
+
+  void run_expiry()
+  {
+    typedef sq::Shared_Queue<int, 8, sq::feature_leases> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    sq::Queue_Lease first;
+    sq::Queue_Lease second;
+    int item = 0;
+
+    SQ_CHECK(queue.enqueue(1) && queue.enqueue(2));
+    SQ_CHECK(queue.lease(&item, &first, second_ns) && item == 1);
+    SQ_CHECK(queue.ack(first) && !queue.ack(first));
+
+    SQ_CHECK(queue.lease(&item, &second, 1000000) && item == 2);
+    SQ_CHECK(queue.is_empty() && queue.redeliver_expired() == 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(3));
+
+    SQ_CHECK(queue.redeliver_expired() == 1);
+    SQ_CHECK(!queue.ack(second));
+    SQ_CHECK(queue.dequeue(&item) && item == 2 && queue.is_empty());
+  }
+
+  void run_full()
+  {
+    typedef sq::Shared_Queue<int, 4, sq::feature_leases | sq::feature_stats> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    sq::Queue_Lease lease;
+    int item = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+      SQ_CHECK(queue.enqueue(i));
+    }
+
+    for (int i = 0; i < 4; ++i)
+    {
+      SQ_CHECK(queue.lease(&item, &lease, 1000));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+    // Each enqueue waits for a leased slot, redelivers the expired leases
+    // into the full queue (overwriting) and then takes a slot
+    for (int i = 0; i < 4; ++i)
+    {
+      SQ_CHECK(queue.enqueue(10 + i));
+    }
+
+    std::size_t count = 0;
+
+    while (queue.dequeue(&item))
+    {
+      ++count;
+    }
+
+    SQ_CHECK(count == 4 && queue.stats().enqueued == 12);
+  }
+
+  void run_recover()
+  {
+    typedef sq::Shared_Queue<int, 8, sq::feature_leases> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+
+    // Shift the positions so the leased slots wrap around the ring
+    for (int start = 0; start < 20; ++start)
+    {
+      std::memset(memory.data(), 0, Queue::required_size());
+
+      Queue queue(memory.data());
+      sq::Queue_Lease leases[3];
+      int item = 0;
+
+      for (int i = 0; i < start; ++i)
+      {
+        SQ_CHECK(queue.enqueue(-1) && queue.dequeue(&item));
+      }
+
+      for (int i = 0; i < 6; ++i)
+      {
+        SQ_CHECK(queue.enqueue(i));
+      }
+
+      SQ_CHECK(queue.lease(&item, &leases[0], second_ns) && item == 0);
+      SQ_CHECK(queue.dequeue(&item) && item == 1);
+      SQ_CHECK(queue.lease(&item, &leases[1], second_ns) && item == 2);
+      SQ_CHECK(queue.ack(leases[1]));
+      SQ_CHECK(queue.lease(&item, &leases[2], second_ns) && item == 3);
+      SQ_CHECK(queue.enqueue(6) && queue.enqueue(7));
+
+      // The lease on item 0 still holds the slot position 8 needs
+      SQ_CHECK(!queue.enqueue(8));
+
+      // Restart as after a crash of every process
+      Queue restarted(memory.data());
+      const int expected[] = { 0, 3, 4, 5, 6, 7 };
+
+      SQ_CHECK(restarted.recover() == 0);
+
+      for (int value : expected)
+      {
+        SQ_CHECK(restarted.dequeue(&item) && item == value);
+      }
+
+      SQ_CHECK(!restarted.dequeue(&item));
+      SQ_CHECK(restarted.redeliver_expired() == 0);
+
+      for (int i = 0; i < 20; ++i)
+      {
+        SQ_CHECK(restarted.enqueue(i) && restarted.dequeue(&item) && item == i);
+      }
+    }
+  }
+
+  void run_shared()
+  {
+    typedef sq::Shared_Queue<std::uint64_t, 4096, sq::feature_leases> Queue;
+
+    constexpr std::uint64_t items = 2000;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    sq_test::Delivery_Log log(items);
+    std::unique_ptr<std::atomic<unsigned char>[]> skipped(new std::atomic<unsigned char>[items]);
+    std::atomic<std::uint64_t> acked{ 0 };
+
+    for (std::uint64_t i = 0; i < items; ++i)
+    {
+      skipped[i].store(0);
+    }
+
+    sq_test::run_threads(4, [&](std::size_t thread)
+    {
+      for (std::uint64_t i = thread; i < items; i += 4)
+      {
+        SQ_CHECK(queue.enqueue(i));
+      }
+
+      sq::Queue_Lease lease;
+      std::uint64_t item = 0;
+
+      while (acked.load() < items)
+      {
+        // Leave every 7th item the first time; lease() redelivers it
+        // after its 100 us expire
+        if (!queue.lease(&item, &lease, 100000) ||
+          (item % 7 == 0 && skipped[item].exchange(1) == 0))
+        {
+          std::this_thread::yield();
+          continue;
+        }
+
+        if (queue.ack(lease))
+        {
+          log.deliver(item);
+          acked.fetch_add(1);
+        }
+      }
+    });
+
+    SQ_CHECK(log.complete() && queue.is_empty());
+  }
+
+  void run_killed()
+  {
+    typedef sq::Shared_Queue<std::uint64_t, 256, sq::feature_leases> Queue;
+
+    constexpr std::uint64_t items = 3000;
+
+    // The queue, then one acknowledgement counter per item
+    sq_test::Test_Memory memory(Queue::required_size() + items, true);
+    SQ_CHECK(memory.data() != nullptr);
+
+    Queue queue(memory.data());
+    std::atomic<unsigned char>* acked = reinterpret_cast<std::atomic<unsigned char>*>(
+      static_cast<char*>(memory.data()) + Queue::required_size());
+
+    auto spawn = [&]()
+    {
+      pid_t child = fork();
+
+      if (child == 0)
+      {
+        Queue attached(memory.data());
+        sq::Queue_Lease lease;
+        std::uint64_t item = 0;
+        sigset_t ack_signals;
+
+        sigemptyset(&ack_signals);
+        sigaddset(&ack_signals, SIGTERM);
+
+        while (true)
+        {
+          if (attached.lease(&item, &lease, 20000000))
+          {
+            // Work on the item for a while, so kills land mid-lease
+            for (volatile int spin = 0; spin < 100000; ++spin)
+            {
+            }
+
+            // The kill (SIGTERM, not handled) may land anywhere but
+            // between a successful ack() and counting it
+            sigprocmask(SIG_BLOCK, &ack_signals, nullptr);
+
+            if (attached.ack(lease))
+            {
+              acked[item].fetch_add(1);
+            }
+
+            sigprocmask(SIG_UNBLOCK, &ack_signals, nullptr);
+          }
+        }
+      }
+
+      return child;
+    };
+
+    pid_t consumers[2] = { spawn(), spawn() };
+
+    for (std::uint64_t i = 0; i < items; ++i)
+    {
+      // Stay below capacity so nothing is overwritten
+      while (queue.size() > 200)
+      {
+        std::this_thread::yield();
+      }
+
+      queue.enqueue(i);
+
+      if (i % 300 == 299)
+      {
+        kill(consumers[0], SIGTERM);
+        waitpid(consumers[0], nullptr, 0);
+        consumers[0] = consumers[1];
+        consumers[1] = spawn();
+      }
+    }
+
+    std::size_t missing = items;
+
+    for (int wait = 0; wait < 1000 && missing != 0; ++wait)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      missing = 0;
+
+      for (std::uint64_t i = 0; i < items; ++i)
+      {
+        missing += (acked[i].load() == 0) ? 1 : 0;
+      }
+    }
+
+    for (pid_t consumer : consumers)
+    {
+      kill(consumer, SIGKILL);
+      waitpid(consumer, nullptr, 0);
+    }
+
+    for (std::uint64_t i = 0; i < items; ++i)
+    {
+      SQ_CHECK(acked[i].load() == 1);
+    }
+  }
+}
+
+int main()
+{
+  run_expiry();
+  run_full();
+  run_recover();
+  run_shared();
+  run_killed();
+
+  std::printf("leases_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Mpsc_Queue: several producers and one consumer
+// draining in bulk through a small ring. Every item must arrive exactly
+// once, and each producer's items in the order they were enqueued.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. mpsc_queue_test.cpp -lpthread -o mpsc_queue_test
+
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <vector>      // For std::vector
+
+#include "../shared_mpsc_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t producers = 4;
+  constexpr std::uint64_t per_producer = 500000;
+
+  typedef sq::Shared_Mpsc_Queue<std::uint64_t, 64> Queue;
+}
+
+int main()
+{
+  // Slots start on a cache line and fill whole lines
+  static_assert(Queue::required_size() % 64 == 0, "slots are not cache line aligned");
+
+  sq_test::Test_Memory memory(Queue::required_size());
+  Queue queue(memory.data());
+
+  sq_test::Delivery_Log log(producers * per_producer);
+  std::vector<std::uint64_t> next(producers, 0);
+  bool in_order = true;
+
+  sq_test::run_threads(producers + 1, [&](std::size_t index)
+  {
+    if (index < producers)
+    {
+      for (std::uint64_t i = 0; i < per_producer; ++i)
+      {
+        while (!queue.enqueue(index * per_producer + i))
+        {
+          std::this_thread::yield();
+        }
+      }
+
+      return;
+    }
+
+    std::uint64_t items[16];
+    std::uint64_t received = 0;
+
+    while (received < producers * per_producer)
+    {
+      std::size_t count = queue.dequeue_bulk(items, 16);
+
+      if (count == 0)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        std::size_t producer = static_cast<std::size_t>(items[i] / per_producer);
+
+        if (producer < producers)
+        {
+          in_order = in_order && items[i] % per_producer == next[producer];
+          next[producer] = items[i] % per_producer + 1;
+        }
+
+        log.deliver(items[i]);
+      }
+
+      received += count;
+    }
+  });
+
+  SQ_CHECK(in_order);
+  SQ_CHECK(log.complete());
+  SQ_CHECK(queue.is_empty());
+
+  std::printf("mpsc_queue_test: %llu items ok\n", static_cast<unsigned long long>(producers * per_producer));
+  return 0;
+}
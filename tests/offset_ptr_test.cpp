@@ -0,0 +1,186 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// sq::offset_ptr, offset_span and offset_list.
+//
+//   basics   Null pointers, self-assignment, arithmetic, and the copy rule:
+//            copies made with the copy constructor or assignment keep their
+//            target, a memcpy'd copy does not.
+//   mapped   Structures built through one mapping of a file resolve in a
+//            second mapping of it at another address, including an item
+//            with an offset_ptr passed through a Shared_Queue.
+//
+// Build (POSIX only):
+//   g++ -std=c++11 -O2 -I.. offset_ptr_test.cpp -o offset_ptr_test
+
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstdlib>     // For mkstemp
+#include <cstring>     // For std::memcpy
+#include <new>         // For placement new
+
+#include <sys/mman.h>  // For mmap, munmap
+#include <unistd.h>    // For ftruncate, unlink, close
+
+#include "../offset_ptr.h"
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  // Points at a value in the shared memory, so it is copied through the
+  // queue with its assignment operator
+  struct Message
+  {
+    std::uint64_t id;
+    sq::offset_ptr<int> target;
+  };
+}
+
+template <> struct sq::is_shareable<Message> : std::true_type {};
+
+namespace
+{
+  typedef sq::Shared_Queue<Message, 4> Queue;
+
+  struct Segment
+  {
+    int values[8];
+    sq::offset_ptr<int> first;
+    sq::offset_ptr<int> none;
+    sq::offset_span<int> span;
+    sq::offset_list<int> list;
+    sq::offset_list_node<int> nodes[4];
+    alignas(64) unsigned char queue[Queue::required_size()];
+  };
+
+  void run_basics()
+  {
+    int values[4] = { 10, 20, 30, 40 };
+
+    sq::offset_ptr<int> empty;
+    sq::offset_ptr<int> from_null(nullptr);
+    SQ_CHECK(!empty && empty.get() == nullptr && !from_null && empty == from_null);
+
+    sq::offset_ptr<int> pointer(&values[1]);
+    SQ_CHECK(pointer && *pointer == 20 && pointer[2] == 40);
+
+    // Self-assignment keeps the target
+    sq::offset_ptr<int>& alias = pointer;
+    pointer = alias;
+    SQ_CHECK(pointer.get() == &values[1]);
+
+    ++pointer;
+    SQ_CHECK(*pointer == 30 && empty < pointer);
+    pointer -= 2;
+    SQ_CHECK(pointer.get() == &values[0]);
+
+    pointer = nullptr;
+    SQ_CHECK(!pointer && pointer == empty);
+
+    // Copies are rebased on their own address
+    sq::offset_ptr<int> original(&values[3]);
+    sq::offset_ptr<int> copies[2] = { original, sq::offset_ptr<int>() };
+    copies[1] = original;
+    SQ_CHECK(copies[0].get() == &values[3] && copies[1].get() == &values[3]);
+
+    sq::offset_ptr<const int> converted(original);
+    SQ_CHECK(converted.get() == &values[3]);
+
+    // A memcpy'd copy keeps the distance, not the target
+    sq::offset_ptr<int> raw[2];
+    raw[0] = &values[0];
+    std::memcpy(static_cast<void*>(&raw[1]), &raw[0], sizeof(raw[0]));
+    SQ_CHECK(reinterpret_cast<char*>(raw[1].get()) == reinterpret_cast<char*>(&values[0]) + sizeof(raw[0]));
+
+    // A null offset_ptr stays null wherever it is copied to
+    std::memcpy(static_cast<void*>(&raw[1]), &empty, sizeof(empty));
+    SQ_CHECK(!raw[1]);
+  }
+
+  void run_mapped()
+  {
+    char path[] = "/tmp/offset_ptr_test_XXXXXX";
+    int fd = mkstemp(path);
+    SQ_CHECK(fd >= 0 && ftruncate(fd, sizeof(Segment)) == 0);
+
+    void* first_view = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void* second_view = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    SQ_CHECK(first_view != MAP_FAILED && second_view != MAP_FAILED && first_view != second_view);
+
+    close(fd);
+    unlink(path);
+
+    // Build everything through the first mapping
+    Segment* built = new (first_view) Segment();
+
+    for (int i = 0; i < 8; ++i)
+    {
+      built->values[i] = i * 3;
+    }
+
+    built->first = &built->values[0];
+    built->span.data = &built->values[2];
+    built->span.size = 4;
+
+    for (int i = 0; i < 4; ++i)
+    {
+      built->nodes[i].value = 100 + i;
+      built->list.push_front(&built->nodes[i]);
+    }
+
+    Queue producer(built->queue);
+    Message message;
+    message.id = 7;
+    message.target = &built->values[5];
+    SQ_CHECK(producer.enqueue(message));
+
+    // Everything resolves to the same memory through the second mapping
+    Segment* seen = static_cast<Segment*>(second_view);
+
+    SQ_CHECK(seen->first.get() == &seen->values[0] && *seen->first == 0);
+    SQ_CHECK(!seen->none && seen->none.get() == nullptr);
+    SQ_CHECK(seen->span.begin() == &seen->values[2] && seen->span.end() == &seen->values[6]);
+
+    int span_sum = 0;
+
+    for (int value : seen->span)
+    {
+      span_sum += value;
+    }
+
+    SQ_CHECK(span_sum == (2 + 3 + 4 + 5) * 3 && seen->span[3] == 15 && !seen->span.empty());
+
+    int expected = 103;
+
+    for (int value : seen->list)
+    {
+      SQ_CHECK(value == expected--);
+    }
+
+    SQ_CHECK(expected == 99 && seen->list.size() == 4);
+
+    // Changes through one mapping show in the other
+    sq::offset_list_node<int>* front = seen->list.pop_front();
+    SQ_CHECK(front == &seen->nodes[3] && !front->next && built->list.front() == &built->nodes[2]);
+
+    Queue consumer(seen->queue);
+    Message received;
+    SQ_CHECK(consumer.dequeue(&received) && received.id == 7);
+    SQ_CHECK(received.target.get() == &seen->values[5] && *received.target == 15);
+
+    munmap(first_view, sizeof(Segment));
+    munmap(second_view, sizeof(Segment));
+  }
+}
+
+int main()
+{
+  run_basics();
+  run_mapped();
+
+  std::printf("offset_ptr_test: ok\n");
+  return 0;
+}
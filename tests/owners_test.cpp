@@ -0,0 +1,162 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Dead process recovery of sq::Shared_Queue with feature_owners.
+//
+//   killed  Producer and consumer processes, single- and multi-threaded
+//           with a handle per thread, are SIGKILLed in the middle of
+//           copying large items. Afterwards recover_abandoned() frees what
+//           they held, and the queue takes and gives back exactly Capacity
+//           items again.
+//   full    A handle that finds the owner table full cannot enqueue or
+//           dequeue until an entry is free and it registers.
+//
+// Build (POSIX only):
+//   g++ -std=c++11 -O2 -I.. owners_test.cpp -lpthread -o owners_test
+
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <memory>      // For std::unique_ptr
+#include <thread>      // For std::thread
+#include <vector>      // For std::vector
+
+#include <signal.h>    // For kill, SIGKILL
+#include <sys/wait.h>  // For waitpid
+#include <unistd.h>    // For fork, usleep
+
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t capacity = 8;
+
+  // Large, so a process is most likely killed while it holds a slot
+  struct Large_Item
+  {
+    std::uint64_t id;
+    unsigned char bytes[256 * 1024];
+  };
+
+  // Enqueue (and dequeue, unless producer) until killed
+  template <typename Queue>
+  void keep_working(void* memory, bool producer)
+  {
+    Queue attached(memory);
+    std::unique_ptr<Large_Item> own(new Large_Item());
+
+    for (std::uint64_t n = 0; ; ++n)
+    {
+      own->id = n;
+      attached.enqueue(*own);
+
+      if (!producer)
+      {
+        attached.dequeue(own.get());
+      }
+    }
+  }
+
+  void run_killed(int threads)
+  {
+    typedef sq::Shared_Queue<Large_Item, capacity, sq::feature_owners> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size(), true);
+    SQ_CHECK(memory.data() != nullptr);
+
+    Queue queue(memory.data());
+    static Large_Item item;
+
+    SQ_CHECK(queue.is_registered());
+
+    for (int round = 0; round < 20; ++round)
+    {
+      bool producer = (round % 2 == 0);
+      pid_t child = fork();
+
+      if (child == 0)
+      {
+        // Each thread registers its own handle (see Dead processes in the README)
+        for (int i = 1; i < threads; ++i)
+        {
+          std::thread(keep_working<Queue>, memory.data(), producer).detach();
+        }
+
+        keep_working<Queue>(memory.data(), producer);
+      }
+
+      usleep(2000 + (round * 777) % 5000);
+      kill(child, SIGKILL);
+      waitpid(child, nullptr, 0);
+
+      while (queue.dequeue(&item))
+      {
+      }
+
+      queue.recover_abandoned();
+
+      while (queue.dequeue(&item))
+      {
+      }
+
+      // Everything the dead process held is back in use
+      SQ_CHECK(queue.is_empty());
+
+      for (std::uint64_t i = 0; i < capacity + 4; ++i)
+      {
+        item.id = i;
+        queue.enqueue(item);
+      }
+
+      std::uint64_t expected = 4;
+
+      while (queue.dequeue(&item))
+      {
+        SQ_CHECK(item.id == expected++);
+      }
+
+      SQ_CHECK(expected == capacity + 4 && queue.is_empty());
+    }
+  }
+
+  void run_full()
+  {
+    typedef sq::Shared_Queue<int, capacity, sq::feature_owners> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    std::vector<std::unique_ptr<Queue>> handles;
+    int item = 0;
+
+    for (int i = 0; i < SQ_OWNER_SLOTS; ++i)
+    {
+      handles.emplace_back(new Queue());
+      SQ_CHECK(handles.back()->create(memory.data()) && handles.back()->is_operational());
+    }
+
+    Queue extra;
+    SQ_CHECK(!extra.create(memory.data()) && !extra.is_operational());
+    SQ_CHECK(!extra.enqueue(1) && !extra.dequeue(&item) && extra.dequeue_bulk(&item, 1) == 0);
+
+    // A copy does not share its source's entry
+    Queue copy(*handles[0]);
+    SQ_CHECK(!copy.is_operational() && !copy.enqueue(1));
+
+    SQ_CHECK(handles[0]->enqueue(5) && handles[1]->dequeue(&item) && item == 5);
+
+    handles.pop_back();
+    SQ_CHECK(extra.create(memory.data()) && extra.is_operational() && extra.enqueue(7));
+    SQ_CHECK(handles[0]->dequeue(&item) && item == 7);
+  }
+}
+
+int main()
+{
+  run_killed(1);
+  run_killed(4);
+  run_full();
+
+  std::printf("owners_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,122 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Payload_Queue: several producers and consumers
+// pass payloads of varying length through a small ring and a pool small
+// enough to run out regularly. Every payload must arrive intact
+// and exactly once, and every block must be back in the pool at the end.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. payload_queue_test.cpp -lpthread -o payload_queue_test
+
+#include <atomic>      // For std::atomic
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstring>     // For std::memcpy
+
+#include "../shared_payload_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t producers = 4;
+  constexpr std::size_t consumers = 4;
+  constexpr std::uint64_t per_producer = 100000;
+  constexpr std::size_t block_size = 256;
+  constexpr std::size_t block_count = 24;
+
+  typedef sq::Shared_Payload_Queue<16, block_size, block_count> Queue;
+
+  std::size_t payload_length(std::uint64_t value)
+  {
+    return sizeof(value) + static_cast<std::size_t>(value % (block_size - sizeof(value) + 1));
+  }
+
+  unsigned char fill_byte(std::uint64_t value, std::size_t i)
+  {
+    return static_cast<unsigned char>(value * 13 + i);
+  }
+}
+
+int main()
+{
+  sq_test::Test_Memory memory(Queue::required_size());
+  Queue queue(memory.data());
+  sq::Payload_Handle handle;
+
+  SQ_CHECK(queue.available() == block_count);
+  SQ_CHECK(queue.allocate(block_size + 1, &handle) == nullptr);
+
+  sq_test::Delivery_Log log(producers * per_producer);
+  std::atomic<std::uint64_t> received{ 0 };
+  std::atomic<std::uint64_t> corrupt{ 0 };
+
+  sq_test::run_threads(producers + consumers, [&](std::size_t index)
+  {
+    if (index < producers)
+    {
+      for (std::uint64_t i = 0; i < per_producer; ++i)
+      {
+        std::uint64_t value = index * per_producer + i;
+        std::size_t length = payload_length(value);
+        sq::Payload_Handle sent;
+        unsigned char* payload = nullptr;
+
+        while ((payload = static_cast<unsigned char*>(queue.allocate(length, &sent))) == nullptr)
+        {
+          std::this_thread::yield();
+        }
+
+        std::memcpy(payload, &value, sizeof(value));
+
+        for (std::size_t b = sizeof(value); b < length; ++b)
+        {
+          payload[b] = fill_byte(value, b);
+        }
+
+        while (!queue.enqueue(sent))
+        {
+          std::this_thread::yield();
+        }
+      }
+
+      return;
+    }
+
+    sq::Payload_Handle taken;
+
+    while (received.load(std::memory_order_relaxed) < producers * per_producer)
+    {
+      if (!queue.dequeue(&taken))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      const unsigned char* payload = static_cast<const unsigned char*>(queue.payload(taken));
+      std::uint64_t value = 0;
+      std::memcpy(&value, payload, sizeof(value));
+      bool intact = (taken.length == payload_length(value));
+
+      for (std::size_t b = sizeof(value); intact && b < taken.length; ++b)
+      {
+        intact = (payload[b] == fill_byte(value, b));
+      }
+
+      corrupt.fetch_add(intact ? 0 : 1, std::memory_order_relaxed);
+      log.deliver(value);
+      queue.deallocate(taken);
+      received.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+
+  SQ_CHECK(corrupt.load() == 0);
+  SQ_CHECK(log.complete());
+  SQ_CHECK(queue.is_empty());
+  SQ_CHECK(queue.available() == block_count);
+
+  std::printf("payload_queue_test: %llu payloads ok\n", static_cast<unsigned long long>(producers * per_producer));
+  return 0;
+}
@@ -0,0 +1,263 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Crash recovery of sq::Persistent_Queue.
+//
+//   interrupted  A file that was grown but never initialized (a crash
+//                during the first open) is refused untouched, and
+//                initialized by an open with recover = true.
+//   concurrent   open() waits while another process holds the file's
+//                initialization lock, and processes creating the same file
+//                at once all end up in one queue; none wipes what another
+//                enqueued.
+//   killed       A process is SIGKILLed while enqueueing. Reopening with
+//                recover = true keeps what it published, in order and
+//                without duplicates, and the queue keeps working.
+//   mismatch     A file holding a queue of another capacity, or something
+//                else entirely, is refused without being resized.
+//
+// Build (POSIX only):
+//   g++ -std=c++11 -O2 -I.. persistent_queue_test.cpp -o persistent_queue_test
+
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <string>      // For std::string, std::to_string
+
+#include <fcntl.h>     // For open
+#include <signal.h>    // For kill, SIGKILL
+#include <sys/file.h>  // For flock
+#include <sys/stat.h>  // For stat
+#include <sys/wait.h>  // For waitpid
+#include <unistd.h>    // For fork, ftruncate, pipe, unlink
+
+#include "../shared_persistent_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t capacity = 256;
+
+  typedef sq::Persistent_Queue<std::uint64_t, capacity> Queue;
+
+  long long file_size(const std::string& path)
+  {
+    struct stat status;
+    return (stat(path.c_str(), &status) == 0) ? static_cast<long long>(status.st_size) : -1;
+  }
+
+  void run_interrupted(const std::string& path)
+  {
+    unlink(path.c_str());
+
+    // Grown to full size, some bytes written, but no layout yet
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    SQ_CHECK(fd >= 0);
+    SQ_CHECK(ftruncate(fd, static_cast<off_t>(sq::Shared_Queue<std::uint64_t, capacity>::required_size())) == 0);
+    SQ_CHECK(pwrite(fd, "\x40\0\0\0\0\0\0\0", 8, 512) == 8);
+    close(fd);
+
+    Queue queue;
+    std::uint64_t item = 0;
+    char byte = 0;
+
+    // Without recover it could be a file of something else
+    SQ_CHECK(!queue.open(path.c_str()));
+    fd = ::open(path.c_str(), O_RDONLY);
+    SQ_CHECK(fd >= 0 && pread(fd, &byte, 1, 512) == 1 && byte == 0x40);
+    close(fd);
+
+    SQ_CHECK(queue.open(path.c_str(), true));
+    SQ_CHECK(queue.is_empty());
+    SQ_CHECK(queue.enqueue(7));
+    queue.close();
+
+    SQ_CHECK(queue.open(path.c_str()));
+    SQ_CHECK(queue.dequeue(&item) && item == 7);
+    queue.close();
+  }
+
+  void run_concurrent(const std::string& path)
+  {
+    constexpr int processes = 4;
+    constexpr std::uint64_t per_process = 50;
+
+    unlink(path.c_str());
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    SQ_CHECK(fd >= 0 && flock(fd, LOCK_EX) == 0);
+
+    pid_t waiting = fork();
+
+    if (waiting == 0)
+    {
+      Queue attached;
+      _exit((attached.open(path.c_str()) && attached.enqueue(1)) ? 0 : 1);
+    }
+
+    // Still waiting for the lock, so it has not touched the file
+    usleep(20000);
+    int status = 0;
+    SQ_CHECK(waitpid(waiting, &status, WNOHANG) == 0 && file_size(path) == 0);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    SQ_CHECK(waitpid(waiting, &status, 0) == waiting && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    for (int round = 0; round < 10; ++round)
+    {
+      unlink(path.c_str());
+
+      int start[2];
+      SQ_CHECK(pipe(start) == 0);
+      pid_t children[processes];
+
+      for (int i = 0; i < processes; ++i)
+      {
+        children[i] = fork();
+
+        if (children[i] == 0)
+        {
+          char go = 0;
+          close(start[1]);
+
+          if (read(start[0], &go, 1) != 0)
+          {
+            _exit(1);
+          }
+
+          Queue attached;
+
+          if (!attached.open(path.c_str()))
+          {
+            _exit(1);
+          }
+
+          for (std::uint64_t n = 0; n < per_process; ++n)
+          {
+            attached.enqueue((i * per_process) + n);
+          }
+
+          _exit(0);
+        }
+      }
+
+      // Closing the pipe releases all children at once
+      close(start[0]);
+      close(start[1]);
+
+      for (pid_t child : children)
+      {
+        SQ_CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+      }
+
+      Queue queue;
+      sq_test::Delivery_Log log(processes * per_process);
+      std::uint64_t item = 0;
+
+      SQ_CHECK(queue.open(path.c_str()));
+
+      while (queue.dequeue(&item))
+      {
+        log.deliver(item);
+      }
+
+      SQ_CHECK(log.complete());
+      queue.close();
+    }
+  }
+
+  void run_killed(const std::string& path)
+  {
+    for (int round = 0; round < 10; ++round)
+    {
+      unlink(path.c_str());
+
+      Queue queue;
+      SQ_CHECK(queue.open(path.c_str()));
+      queue.close();
+
+      pid_t child = fork();
+
+      if (child == 0)
+      {
+        // Enqueue a counting sequence until killed, overwriting when full
+        Queue attached;
+
+        if (!attached.open(path.c_str()))
+        {
+          _exit(1);
+        }
+
+        for (std::uint64_t i = 1; ; ++i)
+        {
+          attached.enqueue(i);
+        }
+      }
+
+      usleep(2000 + round * 500);
+      kill(child, SIGKILL);
+      waitpid(child, nullptr, 0);
+
+      SQ_CHECK(queue.open(path.c_str(), true));
+
+      std::size_t recovered = queue.size();
+      std::uint64_t previous = 0;
+      std::uint64_t item = 0;
+
+      // Only the items in flight at the kill may be missing
+      SQ_CHECK(recovered + queue.discarded_on_recovery() + 1 >= capacity);
+
+      while (queue.dequeue(&item))
+      {
+        SQ_CHECK(item > previous);
+        previous = item;
+      }
+
+      SQ_CHECK(previous != 0);
+      SQ_CHECK(queue.enqueue(previous + 1) && queue.dequeue(&item) && item == previous + 1);
+      queue.close();
+    }
+  }
+
+  void run_mismatch(const std::string& path)
+  {
+    unlink(path.c_str());
+
+    Queue queue;
+    SQ_CHECK(queue.open(path.c_str()));
+    queue.close();
+
+    long long size = file_size(path);
+    sq::Persistent_Queue<std::uint64_t, capacity * 2> larger;
+    sq::Persistent_Queue<std::uint64_t, capacity / 2> smaller;
+    SQ_CHECK(!larger.open(path.c_str()) && !larger.open(path.c_str(), true));
+    SQ_CHECK(!smaller.open(path.c_str()));
+    SQ_CHECK(file_size(path) == size);
+
+    // Not a queue at all
+    unlink(path.c_str());
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    SQ_CHECK(fd >= 0 && write(fd, "not a queue\n", 12) == 12);
+    close(fd);
+
+    SQ_CHECK(!queue.open(path.c_str()) && !queue.open(path.c_str(), true));
+    SQ_CHECK(file_size(path) == 12);
+  }
+}
+
+int main()
+{
+  std::string path = "/tmp/persistent_queue_test_" + std::to_string(getpid()) + ".sq";
+
+  run_interrupted(path);
+  run_concurrent(path);
+  run_killed(path);
+  run_mismatch(path);
+
+  unlink(path.c_str());
+
+  std::printf("persistent_queue_test: ok\n");
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Ring: a producer publishes entries in batches
+// and three stages process them in place, each stage on its own thread.
+// Every entry must pass through every stage exactly once and in order.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. ring_test.cpp -lpthread -o ring_test
+
+#include <atomic>      // For std::atomic
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+
+#include "../shared_ring.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t stages = 3;
+  constexpr std::uint64_t items = 500000;
+
+  struct Entry
+  {
+    std::uint64_t value;
+    std::uint64_t stage;     // Stages that processed the entry so far
+  };
+
+  typedef sq::Shared_Ring<Entry, 64, stages> Ring;
+}
+
+int main()
+{
+  sq_test::Test_Memory memory(Ring::required_size());
+  Ring ring(memory.data());
+  std::atomic<std::size_t> failures{ 0 };
+
+  sq_test::run_threads(stages + 1, [&](std::size_t index)
+  {
+    if (index == stages)
+    {
+      std::uint64_t value = 0;
+
+      while (value < items)
+      {
+        // Claim up to 8 entries, then publish them at once
+        std::size_t sequence = 0;
+        std::size_t claimed = 0;
+        Entry* entry = nullptr;
+
+        while (claimed < 8 && value < items && (entry = ring.claim(&sequence)) != nullptr)
+        {
+          entry->value = value++;
+          entry->stage = 0;
+          ++claimed;
+        }
+
+        if (claimed == 0)
+        {
+          std::this_thread::yield();
+          continue;
+        }
+
+        ring.publish(sequence);
+      }
+
+      return;
+    }
+
+    std::uint64_t expected = 0;
+
+    while (expected < items)
+    {
+      std::size_t next = ring.position(index);
+      std::size_t end = ring.available(index);
+
+      if (next == end)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      for (std::size_t sequence = next; sequence < end; ++sequence)
+      {
+        Entry& entry = ring.at(sequence);
+
+        if (entry.value != expected++ || entry.stage != index)
+        {
+          failures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        entry.stage = index + 1;
+      }
+
+      ring.release(index, end);
+    }
+  });
+
+  SQ_CHECK(failures.load() == 0);
+  SQ_CHECK(ring.is_empty());
+
+  std::printf("ring_test: %llu entries through %llu stages ok\n",
+    static_cast<unsigned long long>(items), static_cast<unsigned long long>(stages));
+  return 0;
+}
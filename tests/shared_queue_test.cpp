@@ -0,0 +1,187 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Queue.
+//
+//   paced      Producers keep the queue at most half full, so nothing is
+//              overwritten: every item must arrive exactly once.
+//   overwrite  Producers run flat out into a tiny queue: no item may arrive
+//              twice, each consumer must see every producer's items in
+//              order, and the counters must account for every item.
+//   stalled    (POSIX) A process stopped in the middle of writing the
+//              oldest slot must not make a full enqueue() block.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. shared_queue_test.cpp -lpthread -o shared_queue_test
+
+#include <atomic>      // For std::atomic
+#include <chrono>      // For std::chrono::steady_clock
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstring>     // For std::memset
+#include <vector>      // For std::vector
+
+#if !defined(_WIN32)
+#include <signal.h>    // For kill, SIGSTOP
+#include <sys/wait.h>  // For waitpid
+#include <unistd.h>    // For fork, usleep
+#endif
+
+#include "../shared_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::size_t producers = 4;
+  constexpr std::size_t consumers = 4;
+  constexpr std::uint64_t per_producer = 200000;
+
+  template <std::size_t Capacity>
+  void run(bool paced)
+  {
+    typedef sq::Shared_Queue<std::uint64_t, Capacity, sq::feature_stats> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size());
+    Queue queue(memory.data());
+    sq_test::Delivery_Log log(producers * per_producer);
+    std::atomic<std::size_t> producers_done{ 0 };
+    std::atomic<std::size_t> failures{ 0 };
+
+    sq_test::run_threads(producers + consumers, [&](std::size_t index)
+    {
+      // Every thread attaches on its own, like a separate process would
+      Queue attached(memory.data());
+
+      if (index < producers)
+      {
+        for (std::uint64_t i = 0; i < per_producer; ++i)
+        {
+          while (paced && attached.size() > Capacity / 2)
+          {
+            std::this_thread::yield();
+          }
+
+          attached.enqueue(index * per_producer + i, i % 5 == 0);
+        }
+
+        producers_done.fetch_add(1, std::memory_order_release);
+        return;
+      }
+
+      std::vector<std::uint64_t> next(producers, 0);
+      std::uint64_t items[8];
+
+      while (true)
+      {
+        std::size_t count = (index % 2 == 0) ? attached.dequeue_bulk(items, 8) : (attached.dequeue(items) ? 1 : 0);
+
+        if (count == 0)
+        {
+          if (producers_done.load(std::memory_order_acquire) == producers && attached.is_empty())
+          {
+            break;
+          }
+
+          std::this_thread::yield();
+          continue;
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          std::size_t producer = static_cast<std::size_t>(items[i] / per_producer);
+
+          if (producer < producers)
+          {
+            failures.fetch_add((items[i] % per_producer < next[producer]) ? 1 : 0, std::memory_order_relaxed);
+            next[producer] = items[i] % per_producer + 1;
+          }
+
+          log.deliver(items[i]);
+        }
+      }
+    });
+
+    sq::Queue_Stats stats = queue.stats();
+
+    SQ_CHECK(failures.load() == 0);
+    SQ_CHECK(log.unique());
+    SQ_CHECK(!paced || log.complete());
+    SQ_CHECK(stats.enqueued == producers * per_producer);
+    SQ_CHECK(stats.enqueued == stats.dequeued + stats.evicted_important + stats.evicted_unimportant);
+    SQ_CHECK(producers * per_producer - log.missing() == stats.dequeued);
+    SQ_CHECK(queue.is_empty());
+  }
+
+#if !defined(_WIN32)
+  struct Large_Item
+  {
+    unsigned char bytes[1 << 20];
+  };
+
+  void run_stalled()
+  {
+    typedef sq::Shared_Queue<Large_Item, 4> Queue;
+
+    sq_test::Test_Memory memory(Queue::required_size(), true);
+    Queue queue(memory.data());
+    static Large_Item item;
+
+    SQ_CHECK(memory.data() != nullptr);
+
+    for (int round = 0; round < 10; ++round)
+    {
+      pid_t child = fork();
+
+      if (child == 0)
+      {
+        // Enqueue until stopped; copying 1 MB items, it is most likely
+        // stopped while it holds a slot
+        Queue attached(memory.data());
+
+        while (true)
+        {
+          attached.enqueue(item);
+        }
+      }
+
+      usleep(10000 + round * 1000);
+      kill(child, SIGSTOP);
+
+      auto begin = std::chrono::steady_clock::now();
+
+      for (int i = 0; i < 8; ++i)
+      {
+        queue.enqueue(item);
+      }
+
+      auto elapsed = std::chrono::steady_clock::now() - begin;
+
+      kill(child, SIGKILL);
+      waitpid(child, nullptr, 0);
+
+      // Returning at all is the point; a second is far more than 8 copies take
+      SQ_CHECK(elapsed < std::chrono::seconds(1));
+
+      // The child may have died holding a slot; start the next round afresh
+      std::memset(memory.data(), 0, Queue::required_size());
+      queue.create(memory.data());
+    }
+  }
+#endif
+}
+
+int main()
+{
+  run<64>(true);
+  run<8>(false);
+  run<2>(false);
+
+#if !defined(_WIN32)
+  run_stalled();
+#endif
+
+  std::printf("shared_queue_test: %llu items ok\n", static_cast<unsigned long long>(3 * producers * per_producer));
+  return 0;
+}
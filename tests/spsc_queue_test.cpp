@@ -0,0 +1,95 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// Stress test of sq::Shared_Spsc_Queue: one producer and one consumer move a
+// counting sequence through a small ring. Every item must arrive exactly
+// once and in order.
+//
+// Build:
+//   g++ -std=c++11 -O2 -I.. spsc_queue_test.cpp -lpthread -o spsc_queue_test
+
+#include <cstdint>     // For std::uint64_t, std::uintptr_t
+#include <cstdio>      // For std::printf
+
+#include "../shared_spsc_queue.h"
+#include "test_common.h"
+
+namespace
+{
+  constexpr std::uint64_t items = 2000000;
+
+  struct Item
+  {
+    std::uint64_t value;
+    std::uint64_t check;
+  };
+
+  typedef sq::Shared_Spsc_Queue<Item, 64> Queue;
+}
+
+int main()
+{
+  sq_test::Test_Memory memory(Queue::required_size());
+  Queue queue(memory.data());
+
+  // Slots start on a cache line and fill whole lines, even for 5 items of 16 bytes
+  static_assert(sq::Shared_Spsc_Queue<Item, 5>::required_size() % 64 == 0, "slots are not cache line aligned");
+
+  Item item{};
+  std::uint64_t enqueued = 0;
+
+  while (queue.enqueue(Item{ enqueued, ~enqueued }))
+  {
+    ++enqueued;
+  }
+
+  SQ_CHECK(enqueued == 64 && queue.size() == 64);
+
+  for (std::uint64_t i = 0; i < enqueued; ++i)
+  {
+    SQ_CHECK(queue.dequeue(&item) && item.value == i);
+  }
+
+  SQ_CHECK(!queue.dequeue(&item) && queue.is_empty());
+
+  std::uint64_t next = 0;
+  bool in_order = true;
+
+  sq_test::run_threads(2, [&](std::size_t index)
+  {
+    if (index == 0)
+    {
+      for (std::uint64_t i = 0; i < items; ++i)
+      {
+        while (!queue.enqueue(Item{ i, ~i }))
+        {
+          std::this_thread::yield();
+        }
+      }
+
+      return;
+    }
+
+    Item received;
+
+    while (next < items)
+    {
+      if (!queue.dequeue(&received))
+      {
+        std::this_thread::yield();
+        continue;
+      }
+
+      in_order = in_order && received.value == next && received.check == ~next;
+      ++next;
+    }
+  });
+
+  SQ_CHECK(in_order);
+  SQ_CHECK(queue.is_empty());
+
+  std::printf("spsc_queue_test: %llu items ok\n", static_cast<unsigned long long>(items));
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_TEST_COMMON_H
+#define MPMC_TEST_COMMON_H
+
+#include <atomic>      // For std::atomic
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint64_t, std::uintptr_t
+#include <cstdio>      // For std::fprintf
+#include <cstdlib>     // For std::exit
+#include <memory>      // For std::unique_ptr
+#include <thread>      // For std::thread
+#include <vector>      // For std::vector
+
+#if !defined(_WIN32)
+#include <sys/mman.h>  // For mmap, munmap
+#endif
+
+// Helpers shared by the tests in this directory. Each test is a standalone
+// program that exits with 0 on success and prints the failed check otherwise.
+#define SQ_CHECK(condition) \
+  do \
+  { \
+    if (!(condition)) \
+    { \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::exit(1); \
+    } \
+  } while (0)
+
+namespace sq_test
+{
+  // Zeroed, cache-line aligned memory for a queue. With shared set, it is a
+  // shared anonymous mapping that survives fork() (POSIX only).
+  class Test_Memory
+  {
+  private:
+    std::vector<unsigned char> storage;
+    void* mapping{ nullptr };
+    std::size_t mapping_size{ 0 };
+    void* aligned{ nullptr };
+
+  public:
+    explicit Test_Memory(std::size_t size, bool shared = false)
+    {
+#if !defined(_WIN32)
+      if (shared)
+      {
+        this->mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        this->mapping_size = size;
+        this->aligned = (this->mapping == MAP_FAILED) ? nullptr : this->mapping;
+        return;
+      }
+#else
+      (void)shared;
+#endif
+      this->storage.assign(size + 64, 0);
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(this->storage.data());
+      this->aligned = reinterpret_cast<void*>((address + 63) & ~std::uintptr_t(63));
+    }
+
+    ~Test_Memory()
+    {
+#if !defined(_WIN32)
+      if (this->aligned != nullptr && this->mapping == this->aligned)
+      {
+        munmap(this->mapping, this->mapping_size);
+      }
+#endif
+    }
+
+    Test_Memory(const Test_Memory&) = delete;
+    Test_Memory& operator=(const Test_Memory&) = delete;
+
+    void* data() const
+    {
+      return this->aligned;
+    }
+  };
+
+  // Start count threads running body(index) and wait for all of them
+  template <typename Function>
+  void run_threads(std::size_t count, Function body)
+  {
+    std::vector<std::thread> threads;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      threads.emplace_back(body, i);
+    }
+
+    for (std::thread& thread : threads)
+    {
+      thread.join();
+    }
+  }
+
+  // Records which of the values 0..count-1 were received, to detect loss
+  // and duplication across threads
+  class Delivery_Log
+  {
+  private:
+    std::unique_ptr<std::atomic<unsigned char>[]> seen;
+    std::size_t count{ 0 };
+    std::atomic<std::size_t> duplicates{ 0 };
+    std::atomic<std::size_t> out_of_range{ 0 };
+
+  public:
+    explicit Delivery_Log(std::size_t count) : seen(new std::atomic<unsigned char>[count]), count(count)
+    {
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        this->seen[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    void deliver(std::uint64_t value)
+    {
+      if (value >= this->count)
+      {
+        this->out_of_range.fetch_add(1, std::memory_order_relaxed);
+      }
+      else if (this->seen[value].exchange(1, std::memory_order_relaxed) != 0)
+      {
+        this->duplicates.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    bool received(std::uint64_t value) const
+    {
+      return value < this->count && this->seen[value].load(std::memory_order_relaxed) != 0;
+    }
+
+    std::size_t missing() const
+    {
+      std::size_t result = 0;
+
+      for (std::size_t i = 0; i < this->count; ++i)
+      {
+        result += (this->seen[i].load(std::memory_order_relaxed) == 0) ? 1 : 0;
+      }
+
+      return result;
+    }
+
+    // Whether no value arrived twice and none was made up
+    bool unique() const
+    {
+      return this->duplicates.load() == 0 && this->out_of_range.load() == 0;
+    }
+
+    // Whether every value arrived exactly once
+    bool complete() const
+    {
+      return this->missing() == 0 && this->unique();
+    }
+  };
+} // namespace sq_test
+
+#endif // MPMC_TEST_COMMON_H
@@ -0,0 +1,432 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// sq-inspect: print the state of a live sq::Shared_Queue from outside the
+// processes using it. The segment is mapped read-only and described by the
+// Queue_Layout at its start, so the tool needs neither T nor Capacity.
+//
+// Build:
+//   g++ -std=c++17 -O2 -I.. sq_inspect.cpp -lrt -o sq-inspect
+//
+// Usage:
+//   sq-inspect <segment name> [--slots=8] [--format=hex|i32|u32|i64|u64|f32|f64|text] [--watch=ms]
+//
+// The segment name is what was passed to shm_open (POSIX, e.g. /my_queue)
+// or CreateFileMapping (Windows, e.g. Local\MySharedQueue).
+
+#include <atomic>      // For std::atomic
+#include <chrono>      // For std::chrono::milliseconds
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstdlib>     // For std::strtoull
+#include <cstring>     // For std::memcpy
+#include <string>      // For std::string
+#include <thread>      // For std::this_thread::sleep_for
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>     // For O_RDONLY
+#include <sys/mman.h>  // For shm_open, mmap
+#include <sys/stat.h>  // For fstat
+#include <unistd.h>    // For close
+#endif
+
+#include "../shared_process.h"
+#include "../shared_queue.h"
+#include "tool_common.h"
+
+namespace
+{
+  struct Mapping
+  {
+    const unsigned char* base{ nullptr };
+    std::size_t size{ 0 };
+
+    bool open(const char* name)
+    {
+#if defined(_WIN32)
+      HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+
+      if (mapping == NULL)
+      {
+        return false;
+      }
+
+      void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      CloseHandle(mapping);
+
+      if (view == NULL)
+      {
+        return false;
+      }
+
+      MEMORY_BASIC_INFORMATION info;
+      VirtualQuery(view, &info, sizeof(info));
+
+      this->base = static_cast<const unsigned char*>(view);
+      this->size = info.RegionSize;
+#else
+      int fd = shm_open(name, O_RDONLY, 0);
+
+      if (fd == -1)
+      {
+        return false;
+      }
+
+      struct stat status;
+
+      if (fstat(fd, &status) != 0 || status.st_size <= 0)
+      {
+        close(fd);
+        return false;
+      }
+
+      void* view = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+
+      if (view == MAP_FAILED)
+      {
+        return false;
+      }
+
+      this->base = static_cast<const unsigned char*>(view);
+      this->size = static_cast<std::size_t>(status.st_size);
+#endif
+      return true;
+    }
+
+    // Relaxed atomic read of a live 8 byte word
+    std::uint64_t load(std::uint64_t offset) const
+    {
+      return reinterpret_cast<const std::atomic<std::uint64_t>*>(this->base + offset)->load(std::memory_order_relaxed);
+    }
+  };
+
+  // Check that the layout is ours and that everything it points at lies
+  // inside the mapping. Returns an error message, or nullptr.
+  const char* validate(const sq::Queue_Layout& layout, std::size_t mapped_size)
+  {
+    if (mapped_size < sizeof(sq::Queue_Layout) || layout.magic != sq::queue_layout_magic)
+    {
+      return "not a Shared_Queue segment, or not initialized yet (bad magic)";
+    }
+
+    if (layout.version != sq::queue_layout_version)
+    {
+      return "unsupported layout version";
+    }
+
+    if (layout.index_size != sizeof(std::uint64_t))
+    {
+      return "queue was built with 32 bit indices";
+    }
+
+    if (layout.capacity < 2 || layout.slot_size < layout.item_size ||
+      layout.item_offset + layout.item_size > layout.slot_size || layout.important_offset >= layout.slot_size ||
+      layout.sequence_offset + 8 > layout.slot_size)
+    {
+      return "inconsistent slot description";
+    }
+
+    if (layout.total_size > mapped_size ||
+      layout.buffer_offset + (layout.capacity * layout.slot_size) > layout.total_size ||
+      layout.head_offset + 8 > layout.buffer_offset || layout.tail_offset + 8 > layout.buffer_offset)
+    {
+      return "offsets point outside the segment";
+    }
+
+    if ((layout.features & sq::feature_stats) != 0 &&
+      (layout.shard_size < 13 * sizeof(std::uint64_t) || layout.high_water_offset + 8 > layout.total_size ||
+        layout.shards_offset + (layout.shard_count * layout.shard_size) > layout.total_size))
+    {
+      return "inconsistent statistics description";
+    }
+
+    if ((layout.features & sq::feature_latency) != 0 &&
+      (layout.histogram_buckets != sq::Latency_Histogram::bucket_count ||
+        layout.histogram_offset + (layout.histogram_buckets * sizeof(std::uint64_t)) > layout.total_size))
+    {
+      return "inconsistent latency histogram description";
+    }
+
+    if ((layout.features & sq::feature_leases) != 0 && layout.lease_offset + 16 > layout.slot_size)
+    {
+      return "inconsistent lease description";
+    }
+
+    if ((layout.features & sq::feature_ttl) != 0 && layout.expiry_offset + 8 > layout.slot_size)
+    {
+      return "inconsistent expiry description";
+    }
+
+    if ((layout.features & sq::feature_owners) != 0 &&
+      (layout.owner_size < 4 * sizeof(std::uint64_t) ||
+        layout.owners_offset + (std::uint64_t(layout.owner_count) * layout.owner_size) > layout.total_size))
+    {
+      return "inconsistent owner table description";
+    }
+
+    return nullptr;
+  }
+
+
+  void print_queue(const Mapping& mapping, const sq::Queue_Layout& layout, std::uint64_t slots, const std::string& format)
+  {
+    std::uint64_t head = mapping.load(layout.head_offset);
+    std::uint64_t tail = mapping.load(layout.tail_offset);
+    std::uint64_t count = (tail - head < layout.capacity) ? tail - head : layout.capacity;
+    std::uint64_t important = 0;
+    std::uint64_t unpublished = 0;
+
+    for (std::uint64_t i = 0; i < count; ++i)
+    {
+      std::uint64_t slot = layout.buffer_offset + (((head + i) % layout.capacity) * layout.slot_size);
+
+      if (mapping.load(slot + layout.sequence_offset) != head + i + 1)
+      {
+        ++unpublished;
+        continue;
+      }
+
+      important += (mapping.base[slot + layout.important_offset] != 0) ? 1 : 0;
+    }
+
+    std::printf("capacity   %llu slots of %llu bytes (item %llu bytes), segment %llu bytes\n",
+      static_cast<unsigned long long>(layout.capacity), static_cast<unsigned long long>(layout.slot_size),
+      static_cast<unsigned long long>(layout.item_size), static_cast<unsigned long long>(layout.total_size));
+    std::printf("head %llu  tail %llu  count %llu  fill %.1f%%\n", static_cast<unsigned long long>(head),
+      static_cast<unsigned long long>(tail), static_cast<unsigned long long>(count),
+      100.0 * static_cast<double>(count) / static_cast<double>(layout.capacity));
+    std::printf("importance %llu important, %llu unimportant, %llu reserved but not published\n",
+      static_cast<unsigned long long>(important), static_cast<unsigned long long>(count - important - unpublished),
+      static_cast<unsigned long long>(unpublished));
+
+    if ((layout.features & sq::feature_stats) != 0)
+    {
+      std::uint64_t totals[13] = {};
+
+      for (std::uint64_t shard = 0; shard < layout.shard_count; ++shard)
+      {
+        for (std::uint64_t counter = 0; counter < 13; ++counter)
+        {
+          totals[counter] += mapping.load(layout.shards_offset + (shard * layout.shard_size) + (counter * 8));
+        }
+      }
+
+      std::printf("stats      enqueued %llu  dequeued %llu  evicted important %llu  evicted unimportant %llu\n"
+        "           full hits %llu  empty polls %llu  high water %llu  expired %llu\n",
+        static_cast<unsigned long long>(totals[0]), static_cast<unsigned long long>(totals[1]),
+        static_cast<unsigned long long>(totals[2]), static_cast<unsigned long long>(totals[3]),
+        static_cast<unsigned long long>(totals[4]), static_cast<unsigned long long>(totals[5]),
+        static_cast<unsigned long long>(mapping.load(layout.high_water_offset)),
+        static_cast<unsigned long long>(totals[12]));
+
+      if ((layout.features & sq::feature_contention) != 0)
+      {
+        std::printf("contention enqueue: cas failures %llu  spins %llu  parks %llu\n"
+          "           dequeue: cas failures %llu  spins %llu  parks %llu\n",
+          static_cast<unsigned long long>(totals[6]), static_cast<unsigned long long>(totals[7]),
+          static_cast<unsigned long long>(totals[8]), static_cast<unsigned long long>(totals[9]),
+          static_cast<unsigned long long>(totals[10]), static_cast<unsigned long long>(totals[11]));
+      }
+    }
+
+    if ((layout.features & sq::feature_latency) != 0)
+    {
+      sq::Latency_Histogram histogram;
+
+      for (std::size_t i = 0; i < sq::Latency_Histogram::bucket_count; ++i)
+      {
+        histogram.counts[i] = mapping.load(layout.histogram_offset + (i * sizeof(std::uint64_t)));
+      }
+
+      std::printf("latency    samples %llu  p50 %llu  p99 %llu  p99.9 %llu (%s)\n",
+        static_cast<unsigned long long>(histogram.total()),
+        static_cast<unsigned long long>(histogram.percentile(50.0)),
+        static_cast<unsigned long long>(histogram.percentile(99.0)),
+        static_cast<unsigned long long>(histogram.percentile(99.9)),
+        (layout.histogram_unit == 1) ? "TSC ticks" : "ns");
+    }
+
+    if ((layout.features & sq::feature_leases) != 0)
+    {
+      std::uint64_t now = sq::detail::steady_ns();
+      std::uint64_t leased = 0;
+      std::uint64_t expired = 0;
+
+      for (std::uint64_t i = 0; i < layout.capacity; ++i)
+      {
+        std::uint64_t slot = layout.buffer_offset + (i * layout.slot_size);
+        std::uint64_t sequence = mapping.load(slot + layout.sequence_offset);
+
+        // Claimed behind head and stamped with a lease for that position
+        if (sequence == 0 || static_cast<std::int64_t>(head - (sequence - 1)) <= 0 ||
+          mapping.load(slot + layout.lease_offset) != sequence)
+        {
+          continue;
+        }
+
+        ++leased;
+        expired += (mapping.load(slot + layout.lease_offset + 8) <= now) ? 1 : 0;
+      }
+
+      std::printf("leases     %llu in flight, %llu expired\n", static_cast<unsigned long long>(leased),
+        static_cast<unsigned long long>(expired));
+    }
+
+    if ((layout.features & sq::feature_ttl) != 0)
+    {
+      std::uint64_t now = sq::detail::steady_ns();
+      std::uint64_t expiring = 0;
+      std::uint64_t expired = 0;
+
+      for (std::uint64_t i = 0; i < count; ++i)
+      {
+        std::uint64_t slot = layout.buffer_offset + (((head + i) % layout.capacity) * layout.slot_size);
+        std::uint64_t expiry = mapping.load(slot + layout.expiry_offset);
+
+        if (mapping.load(slot + layout.sequence_offset) != head + i + 1 || expiry == 0)
+        {
+          continue;
+        }
+
+        ++expiring;
+        expired += (expiry <= now) ? 1 : 0;
+      }
+
+      std::printf("ttl        %llu queued items with a TTL, %llu expired and waiting to be dropped\n",
+        static_cast<unsigned long long>(expiring), static_cast<unsigned long long>(expired));
+    }
+
+    if ((layout.features & sq::feature_owners) != 0)
+    {
+      std::uint64_t registered = 0;
+      std::uint64_t dead = 0;
+
+      for (std::uint32_t i = 0; i < layout.owner_count; ++i)
+      {
+        std::uint64_t entry = layout.owners_offset + (std::uint64_t(i) * layout.owner_size);
+        std::uint64_t pid = mapping.load(entry);
+
+        if (pid == 0)
+        {
+          continue;
+        }
+
+        bool alive = sq::detail::process_is_alive(pid);
+        std::uint64_t producing = mapping.load(entry + 8);
+        std::uint64_t consuming = mapping.load(entry + 16);
+
+        ++registered;
+        dead += alive ? 0 : 1;
+
+        if (!alive)
+        {
+          std::printf("dead owner pid %llu, last reserved %lld, last claimed %lld (+%llu)\n",
+            static_cast<unsigned long long>(pid), static_cast<long long>(producing) - 1,
+            static_cast<long long>(consuming) - 1, static_cast<unsigned long long>(mapping.load(entry + 24)));
+        }
+      }
+
+      std::printf("owners     %llu registered of %u, %llu dead\n", static_cast<unsigned long long>(registered),
+        layout.owner_count, static_cast<unsigned long long>(dead));
+    }
+
+    std::uint64_t shown = (slots < count) ? slots : count;
+
+    for (std::uint64_t i = 0; i < shown; ++i)
+    {
+      std::uint64_t index = (head + i) % layout.capacity;
+      std::uint64_t offset = layout.buffer_offset + (index * layout.slot_size);
+      const unsigned char* slot = mapping.base + offset;
+
+      if (mapping.load(offset + layout.sequence_offset) != head + i + 1)
+      {
+        std::printf("[%5llu]  (reserved, not published)\n", static_cast<unsigned long long>(index));
+        continue;
+      }
+
+      std::printf("[%5llu]%s ", static_cast<unsigned long long>(index), (slot[layout.important_offset] != 0) ? " !" : "  ");
+      std::size_t size = static_cast<std::size_t>(layout.item_size);
+      sq_tools::print_item(slot + layout.item_offset, size, format, 12);
+    }
+  }
+} // namespace
+
+int main(int argc, char** argv)
+{
+  const char* name = nullptr;
+  std::uint64_t slots = 8;
+  std::uint64_t watch_ms = 0;
+  std::string format = "hex";
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string argument = argv[i];
+
+    if (argument.compare(0, 8, "--slots=") == 0)
+    {
+      slots = std::strtoull(argument.c_str() + 8, nullptr, 10);
+    }
+    else if (argument.compare(0, 9, "--format=") == 0)
+    {
+      format = argument.substr(9);
+    }
+    else if (argument.compare(0, 8, "--watch=") == 0)
+    {
+      watch_ms = std::strtoull(argument.c_str() + 8, nullptr, 10);
+    }
+    else if (name == nullptr && argument.compare(0, 2, "--") != 0)
+    {
+      name = argv[i];
+    }
+    else
+    {
+      name = nullptr;
+      break;
+    }
+  }
+
+  if (name == nullptr ||
+    (format != "hex" && format != "text" && format != "i32" && format != "u32" && format != "f32" &&
+      format != "i64" && format != "u64" && format != "f64"))
+  {
+    std::fprintf(stderr, "usage: %s <segment name> [--slots=8] [--format=hex|i32|u32|i64|u64|f32|f64|text] [--watch=ms]\n", argv[0]);
+    return 2;
+  }
+
+  Mapping mapping;
+
+  if (!mapping.open(name))
+  {
+    std::fprintf(stderr, "%s: cannot map segment %s read-only\n", argv[0], name);
+    return 1;
+  }
+
+  sq::Queue_Layout layout;
+  std::memcpy(&layout, mapping.base, (mapping.size < sizeof(layout)) ? mapping.size : sizeof(layout));
+
+  if (const char* error = validate(layout, mapping.size))
+  {
+    std::fprintf(stderr, "%s: %s: %s\n", argv[0], name, error);
+    return 1;
+  }
+
+  do
+  {
+    print_queue(mapping, layout, slots, format);
+
+    if (watch_ms != 0)
+    {
+      std::printf("\n");
+      std::fflush(stdout);
+      std::this_thread::sleep_for(std::chrono::milliseconds(watch_ms));
+    }
+  } while (watch_ms != 0);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+// sq-journal: verify and print a journal written by sq::Journal_Writer.
+// The item size comes from the journal header, so the tool needs no T.
+// Replaying into a queue needs T; use sq::replay_journal<T>() for that.
+//
+// Build:
+//   g++ -std=c++17 -O2 -I.. sq_journal.cpp -o sq-journal
+//
+// Usage:
+//   sq-journal <file> [--from=0] [--count=8] [--format=hex|i32|u32|i64|u64|f32|f64|text]
+//
+// Checks every record's checksum and that sequence numbers have no gaps,
+// prints a summary, then count records starting at sequence number from.
+
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::uint64_t
+#include <cstdio>      // For std::printf, std::fopen
+#include <cstdlib>     // For std::strtoull
+#include <cstring>     // For std::memcpy
+#include <string>      // For std::string
+#include <vector>      // For std::vector
+
+#include "../shared_journal.h"
+#include "tool_common.h"
+
+int main(int argc, char** argv)
+{
+  const char* path = nullptr;
+  std::uint64_t from = 0;
+  std::uint64_t count = 8;
+  std::string format = "hex";
+
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string argument = argv[i];
+
+    if (argument.compare(0, 7, "--from=") == 0)
+    {
+      from = std::strtoull(argument.c_str() + 7, nullptr, 10);
+    }
+    else if (argument.compare(0, 8, "--count=") == 0)
+    {
+      count = std::strtoull(argument.c_str() + 8, nullptr, 10);
+    }
+    else if (argument.compare(0, 9, "--format=") == 0)
+    {
+      format = argument.substr(9);
+    }
+    else if (path == nullptr && argument.compare(0, 2, "--") != 0)
+    {
+      path = argv[i];
+    }
+    else
+    {
+      path = nullptr;
+      break;
+    }
+  }
+
+  if (path == nullptr ||
+    (format != "hex" && format != "text" && format != "i32" && format != "u32" && format != "f32" &&
+      format != "i64" && format != "u64" && format != "f64"))
+  {
+    std::fprintf(stderr, "usage: %s <file> [--from=0] [--count=8] [--format=hex|i32|u32|i64|u64|f32|f64|text]\n", argv[0]);
+    return 2;
+  }
+
+  std::FILE* file = std::fopen(path, "rb");
+
+  if (file == nullptr)
+  {
+    std::fprintf(stderr, "%s: cannot open %s\n", argv[0], path);
+    return 1;
+  }
+
+  sq::Journal_Header header{};
+
+  if (std::fread(&header, sizeof(header), 1, file) != 1 || header.magic != sq::journal_magic ||
+    header.version != sq::journal_version || header.record_size < sizeof(sq::Journal_Record) + header.item_size ||
+    std::fseek(file, static_cast<long>(header.header_size), SEEK_SET) != 0)
+  {
+    std::fprintf(stderr, "%s: %s: not a journal, or unsupported version\n", argv[0], path);
+    std::fclose(file);
+    return 1;
+  }
+
+  std::vector<unsigned char> record(header.record_size);
+  std::uint64_t records = 0;
+  std::uint64_t important = 0;
+  std::uint64_t first = 0;
+  std::uint64_t gaps = 0;
+  std::uint64_t shown = 0;
+  bool corrupt = false;
+
+  while (std::fread(record.data(), record.size(), 1, file) == 1)
+  {
+    sq::Journal_Record entry;
+    std::memcpy(&entry, record.data(), sizeof(entry));
+
+    std::uint32_t checksum = sq::detail::fnv1a(&entry.sequence, sizeof(entry.sequence));
+    checksum = sq::detail::fnv1a(&entry.flags, sizeof(entry.flags), checksum);
+    checksum = sq::detail::fnv1a(record.data() + sizeof(entry), header.item_size, checksum);
+
+    if (checksum != entry.checksum)
+    {
+      corrupt = true;
+      break;
+    }
+
+    first = (records == 0) ? entry.sequence : first;
+    gaps += (entry.sequence != first + records) ? 1 : 0;
+    important += ((entry.flags & sq::journal_important) != 0) ? 1 : 0;
+    ++records;
+
+    if (entry.sequence >= from && shown < count)
+    {
+      std::printf("[%10llu]%s ", static_cast<unsigned long long>(entry.sequence),
+        ((entry.flags & sq::journal_important) != 0) ? " !" : "  ");
+      sq_tools::print_item(record.data() + sizeof(entry), header.item_size, format, 21);
+      ++shown;
+    }
+  }
+
+  std::fclose(file);
+
+  std::printf("journal    %llu records of %u bytes (item %u bytes), sequence %llu..%llu, %llu important\n",
+    static_cast<unsigned long long>(records), header.record_size, header.item_size,
+    static_cast<unsigned long long>(first), static_cast<unsigned long long>(first + records - (records != 0 ? 1 : 0)),
+    static_cast<unsigned long long>(important));
+
+  if (gaps != 0)
+  {
+    std::printf("warning    %llu records out of sequence\n", static_cast<unsigned long long>(gaps));
+  }
+
+  if (corrupt)
+  {
+    std::printf("warning    checksum mismatch after record %llu; the rest of the file is unreadable\n",
+      static_cast<unsigned long long>(first + records));
+  }
+
+  return (corrupt || gaps != 0) ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) [2024] [Jovan J. E. Odassius]
+//
+// License: MIT (See the LICENSE file in the root directory)
+// Github: https://github.com/untyper/mpmc-shared-queue
+
+#ifndef MPMC_TOOL_COMMON_H
+#define MPMC_TOOL_COMMON_H
+
+#include <cstddef>     // For std::size_t
+#include <cstdint>     // For std::int32_t, std::uint64_t
+#include <cstdio>      // For std::printf
+#include <cstring>     // For std::memcpy
+#include <string>      // For std::string
+
+// Helpers shared by the tools in this directory
+namespace sq_tools
+{
+  // Print an item of size bytes on one line, as --format selects: hex bytes
+  // (32 per line, continued after indent spaces), fixed width numbers, or
+  // text up to the first NUL
+  inline void print_item(const unsigned char* item, std::size_t size, const std::string& format, int indent)
+  {
+    if (format == "text")
+    {
+      std::printf("\"");
+
+      for (std::size_t i = 0; i < size && item[i] != 0; ++i)
+      {
+        std::printf((item[i] >= 32 && item[i] < 127) ? "%c" : "\\x%02x", item[i]);
+      }
+
+      std::printf("\"\n");
+      return;
+    }
+
+    std::size_t width = (format == "i32" || format == "u32" || format == "f32") ? 4
+      : (format == "i64" || format == "u64" || format == "f64") ? 8 : 1;
+
+    for (std::size_t i = 0; i + width <= size; i += width)
+    {
+      if (width == 1)
+      {
+        if ((i + 1) % 32 == 0 && i + 1 < size)
+        {
+          std::printf("%02x\n%*s", item[i], indent, "");
+        }
+        else
+        {
+          std::printf("%02x ", item[i]);
+        }
+
+        continue;
+      }
+
+      unsigned char bytes[8];
+      std::memcpy(bytes, item + i, width);
+
+      if (format == "i32") { std::int32_t v; std::memcpy(&v, bytes, 4); std::printf("%d ", v); }
+      else if (format == "u32") { std::uint32_t v; std::memcpy(&v, bytes, 4); std::printf("%u ", v); }
+      else if (format == "f32") { float v; std::memcpy(&v, bytes, 4); std::printf("%g ", v); }
+      else if (format == "i64") { std::int64_t v; std::memcpy(&v, bytes, 8); std::printf("%lld ", static_cast<long long>(v)); }
+      else if (format == "u64") { std::uint64_t v; std::memcpy(&v, bytes, 8); std::printf("%llu ", static_cast<unsigned long long>(v)); }
+      else { double v; std::memcpy(&v, bytes, 8); std::printf("%g ", v); }
+    }
+
+    std::printf("\n");
+  }
+} // namespace sq_tools
+
+#endif // MPMC_TOOL_COMMON_H